@@ -0,0 +1,301 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef CARRAY_H
+#define CARRAY_H
+
+#include <string.h>
+
+/** number of bytes a CArray stores without a heap allocation */
+#define CARRAY_INLINE 32
+
+/** implements a byte array
+ *
+ * It has the same interface as Array, but keeps up to CARRAY_INLINE
+ * bytes (which covers nearly all KNX frames) in the object itself.
+ * Larger arrays grow geometrically and shrinking never reallocates.
+ */
+class CArray
+{
+  /** pointer to the data, either local or a heap block */
+  uchar *data;
+  /** element count */
+  unsigned count;
+  /** size of the storage data points to */
+  unsigned alloc;
+  /** inline storage */
+  uchar local[CARRAY_INLINE];
+
+  /** release a heap block and switch back to the inline storage */
+  void release ()
+  {
+    if (data != local)
+      delete[]data;
+    data = local;
+    alloc = CARRAY_INLINE;
+  }
+
+  /** takes the content of a, which is left empty */
+  void take (CArray & a)
+  {
+    count = a.count;
+    if (a.data == a.local)
+      {
+	data = local;
+	alloc = CARRAY_INLINE;
+	memcpy (local, a.local, count);
+      }
+    else
+      {
+	data = a.data;
+	alloc = a.alloc;
+	a.data = a.local;
+	a.alloc = CARRAY_INLINE;
+      }
+    a.count = 0;
+  }
+
+public:
+  /** create empty array */
+  CArray ()
+  {
+    data = local;
+    count = 0;
+    alloc = CARRAY_INLINE;
+  }
+  /** destructor */
+  ~CArray ()
+  {
+    if (data != local)
+      delete[]data;
+  }
+  /** copy constructor */
+  CArray (const CArray & a)
+  {
+    data = local;
+    count = 0;
+    alloc = CARRAY_INLINE;
+    set (a.data, a.count);
+  }
+#if __cplusplus >= 201103L
+  /** move constructor */
+  CArray (CArray && a)
+  {
+    take (a);
+  }
+  /** move assignment */
+  CArray & operator = (CArray && a)
+  {
+    if (this != &a)
+      {
+	release ();
+	take (a);
+      }
+    return *this;
+  }
+#endif
+
+  /** create array from old style array
+   * @param elem pointer to elements
+   * @param cnt element count
+   */
+  CArray (const uchar elem[], unsigned cnt)
+  {
+    data = local;
+    count = 0;
+    alloc = CARRAY_INLINE;
+    set (elem, cnt);
+  }
+
+  /** set content to them of a old style array
+   * @param elem pointer to elements
+   * @param cnt element count
+   */
+  void set (const uchar elem[], unsigned cnt)
+  {
+    resize (cnt);
+    if (cnt)
+      memmove (data, elem, cnt);
+  }
+
+  /** copy content of an array */
+  void set (const CArray & a)
+  {
+    set (a.data, a.count);
+  }
+
+  /** replace a part of the array and resize to fit
+   * @param elem pointer to new elements
+   * @param start start position
+   * @param cnt element count
+   */
+  void setpart (const uchar elem[], unsigned start, unsigned cnt)
+  {
+    if (cnt + start > count)
+      resize (cnt + start);
+    if (cnt)
+      memmove (data + start, elem, cnt);
+  }
+
+  /** replace a part of the array with the content of a and resize to fit
+   * @param start start index
+   * @param a new elements
+   */
+  void setpart (const CArray & a, unsigned start)
+  {
+    setpart (a.data, start, a.count);
+  }
+
+  /** delete content
+   * @param start start index
+   * @param cnt element count
+   */
+  void deletepart (unsigned start, unsigned cnt)
+  {
+    if (start >= count)
+      return;
+    if (cnt <= 0)
+      return;
+    if (start + cnt >= count)
+      cnt = count - start;
+    memmove (data + start, data + start + cnt, count - start - cnt);
+    count -= cnt;
+  }
+
+  /** assignement operator */
+  const CArray & operator = (const CArray & a)
+  {
+    if (this != &a)
+      set (a.data, a.count);
+    return *this;
+  }
+
+  /** exchanges the content with a without copying heap blocks */
+  void swap (CArray & a)
+  {
+    CArray x;
+    x.take (a);
+    a.take (*this);
+    take (x);
+  }
+
+  /** compare array elementwise for equal */
+  bool operator== (const CArray & a) const
+  {
+    return a.count == count && !memcmp (a.data, data, count);
+  }
+
+  /** compare array elementwise for not equal */
+  bool operator!= (const CArray & a) const
+  {
+    return !(*this == a);
+  }
+
+  /** returns pointer to the elements */
+  const uchar *array () const
+  {
+    return data;
+  }
+
+  /** returns pointer to the elements */
+  uchar *array ()
+  {
+    return data;
+  }
+
+  /** makes room for at least size elements without changing the content */
+  void reserve (unsigned size)
+  {
+    if (size <= alloc)
+      return;
+    if (size < 2 * alloc)
+      size = 2 * alloc;
+    uchar *d1 = new uchar[size];
+    memcpy (d1, data, count);
+    if (data != local)
+      delete[]data;
+    data = d1;
+    alloc = size;
+  }
+
+  /** resize array to newcount elements */
+  void resize (unsigned newcount)
+  {
+    reserve (newcount);
+    count = newcount;
+  }
+
+  /** insert elem at pos */
+  void insert (unsigned pos, const uchar & elem)
+  {
+    if (pos >= count)
+      {
+	add (elem);
+	return;
+      }
+    uchar e = elem;
+    resize (count + 1);
+    memmove (data + pos + 1, data + pos, count - pos - 1);
+    data[pos] = e;
+  }
+
+  /** add element elem to the add */
+  void add (const uchar & elem)
+  {
+    uchar e = elem;
+    resize (count + 1);
+    data[count - 1] = e;
+  }
+  /** access random element in standart C notation */
+  uchar & operator[](unsigned elem)
+  {
+    //no boundcheck
+    return data[elem];
+  }
+  /** access random element in standart C notation */
+  const uchar & operator[] (unsigned elem) const
+  {
+    //no boundcheck
+    return data[elem];
+  }
+  /** returns element count */
+  unsigned operator  () () const
+  {
+    return count;
+  }
+  /** return element count */
+  unsigned len () const
+  {
+    return count;
+  }
+
+  void sort ()
+  {
+    for (unsigned i = 0; i < count; i++)
+      for (unsigned j = i + 1; j < count; j++)
+	if (data[i] > data[j])
+	  {
+	    uchar x = data[i];
+	    data[i] = data[j];
+	    data[j] = x;
+	  }
+  }
+};
+
+#endif
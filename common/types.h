@@ -28,8 +28,7 @@
 /** unsigned char */
 typedef uint8_t uchar;
 
-/** Array of characters */
-typedef Array < uchar > CArray;
+#include "carray.h"
 
 /** EIB address */
 typedef uint16_t eibaddr_t;
@@ -19,6 +19,12 @@
 
 #include "eibnettunnel.h"
 #include "emi.h"
+#include "metrics.h"
+
+/** repeated tunnel requests */
+static Counter retries ("backend.tunnel.retries");
+/** frames dropped after too many repetitions */
+static Counter dropped ("backend.tunnel.dropped");
 
 bool
 EIBNetIPTunnel::addAddress (eibaddr_t addr)
@@ -577,9 +583,11 @@ EIBNetIPTunnel::Run (pth_sem_t * stop1)
 	{
 	  mod = 1;
 	  retry++;
+	  retries.inc ();
 	  if (retry > 3)
 	    {
 	      TRACEPRINTF (t, 1, this, "Drop");
+	      dropped.inc ();
 	      pth_sem_dec (&insignal);
 	      inqueue.get ();
 	      retry = 0;
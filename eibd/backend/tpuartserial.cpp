@@ -21,6 +21,12 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include "tpuartserial.h"
+#include "metrics.h"
+
+/** repeated sends */
+static Counter retries ("backend.tpuart.retries");
+/** frames dropped after too many repetitions */
+static Counter dropped ("backend.tpuart.dropped");
 
 /** get serial status lines */
 static int
@@ -374,11 +380,13 @@ TPUARTSerialLayer2Driver::Run (pth_sem_t * stop1)
 	      if (waitconfirm)
 		{
 		  retry++;
+		  retries.inc ();
 		  waitconfirm = 0;
 		  TRACEPRINTF (t, 0, this, "NACK");
 		  if (retry > 3)
 		    {
 		      TRACEPRINTF (t, 0, this, "Drop NACK");
+		      dropped.inc ();
 		      delete inqueue.get ();
 		      pth_sem_dec (&in_signal);
 		      retry = 0;
@@ -533,10 +541,12 @@ TPUARTSerialLayer2Driver::Run (pth_sem_t * stop1)
 	  && pth_event_status (sendtimeout) == PTH_STATUS_OCCURRED)
 	{
 	  retry++;
+	  retries.inc ();
 	  waitconfirm = 0;
 	  if (retry >= 3)
 	    {
 	      TRACEPRINTF (t, 0, this, "Drop Send");
+	      dropped.inc ();
 	      delete inqueue.get ();
 	      pth_sem_dec (&in_signal);
 	    }
@@ -26,6 +26,7 @@
 */
 
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include "eibclient-int.h"
 
@@ -38,6 +39,12 @@ EIBClose (EIBConnection * con)
       return -1;
     }
   close (con->fd);
+  if (con->ring)
+    {
+      munmap (con->ring, EIB_SHM_RING_HEADER + con->ringsize);
+      close (con->ringfd);
+      close (con->spacefd);
+    }
   if (con->buf)
     free (con->buf);
   free (con);
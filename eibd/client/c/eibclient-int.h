@@ -53,6 +53,18 @@ struct _EIBConnection
   unsigned buflen;
   /** used buffer */
   unsigned size;
+  /** number of packets dropped by eibd, as last reported */
+  uint32_t dropped;
+  /** shared memory ring of EIB_Shm_Open, 0 if not used */
+  uchar *ring;
+  /** size of the data area of ring */
+  uint32_t ringsize;
+  /** read position after the last returned record */
+  uint32_t ringpos;
+  /** eventfd, which eibd signals for new records */
+  int ringfd;
+  /** eventfd, which is signalled for eibd, when space was freed */
+  int spacefd;
   struct
   {
     int sendlen;
@@ -79,6 +91,9 @@ struct _EIBConnection
 int _EIB_SendRequest (EIBConnection * con, unsigned int size, uchar * data);
 int _EIB_CheckRequest (EIBConnection * con, int block);
 int _EIB_GetRequest (EIBConnection * con);
+int _EIB_CheckDropped (EIBConnection * con);
+int _EIB_RingGet (EIBConnection * con, const uchar ** data, int block);
+int _EIB_RingArm (EIBConnection * con);
 
 #define EIBC_LICENSE(text)
 
@@ -83,6 +83,36 @@ _EIB_CheckRequest (EIBConnection * con, int block)
   struct timeval tv;
   fd_set readset;
 
+  if (con->ring)
+    {
+      const uchar *data;
+      if (con->readlen >= 2 && con->readlen >= con->size + 2)
+	return 0;
+      i = _EIB_RingGet (con, &data, block);
+      if (i <= 0)
+	return i;
+      if (i < 2)
+	{
+	  errno = ECONNRESET;
+	  return -1;
+	}
+      if ((unsigned) i > con->buflen)
+	{
+	  con->buf = (uchar *) realloc (con->buf, i);
+	  if (con->buf == 0)
+	    {
+	      con->buflen = 0;
+	      errno = ENOMEM;
+	      return -1;
+	    }
+	  con->buflen = i;
+	}
+      memcpy (con->buf, data, i);
+      con->size = i;
+      con->readlen = i + 2;
+      return 0;
+    }
+
   if (!block)
     {
       tv.tv_sec = 0;
@@ -151,17 +181,33 @@ _EIB_CheckRequest (EIBConnection * con, int block)
   return 0;
 }
 
+/** consumes a complete drop report of eibd; returns 1, if it was one */
+int
+_EIB_CheckDropped (EIBConnection * con)
+{
+  if (con->size < 6 || EIBTYPE (con) != EIB_DROPPED_PACKETS)
+    return 0;
+  con->dropped = (con->buf[2] << 24) | (con->buf[3] << 16) |
+    (con->buf[4] << 8) | (con->buf[5]);
+  con->readlen = 0;
+  return 1;
+}
+
 /** receive packet from eibd */
 int
 _EIB_GetRequest (EIBConnection * con)
 {
   do
     {
-      if (_EIB_CheckRequest (con, 1) == -1)
-	return -1;
+      do
+	{
+	  if (_EIB_CheckRequest (con, 1) == -1)
+	    return -1;
+	}
+      while (con->readlen < 2
+	     || (con->readlen >= 2 && con->readlen < con->size + 2));
     }
-  while (con->readlen < 2
-	 || (con->readlen >= 2 && con->readlen < con->size + 2));
+  while (_EIB_CheckDropped (con));
 
   con->readlen = 0;
 
@@ -0,0 +1,101 @@
+/*
+    EIBD client library
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    In addition to the permissions in the GNU General Public License, 
+    you may link the compiled version of this file into combinations
+    with other programs, and distribute those combinations without any 
+    restriction coming from the use of this file. (The General Public 
+    License restrictions do apply in other respects; for example, they 
+    cover modification of the file, and distribution when not linked into 
+    a combine executable.)
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include "eibclient-int.h"
+
+/** sends request number index of req tagged with its index */
+static int
+sendtagged (EIBConnection * con, int index, EIBMCRequest * req)
+{
+  uchar *ibuf;
+  int i;
+
+  if (!req->req || req->req_len < 2 || req->req_len > 0xffff - 4)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  ibuf = (uchar *) malloc (req->req_len + 4);
+  if (!ibuf)
+    {
+      errno = ENOMEM;
+      return -1;
+    }
+  EIBSETTYPE (ibuf, EIB_MC_TAGGED);
+  ibuf[2] = (index >> 8) & 0xff;
+  ibuf[3] = (index) & 0xff;
+  memcpy (ibuf + 4, req->req, req->req_len);
+  i = _EIB_SendRequest (con, req->req_len + 4, ibuf);
+  free (ibuf);
+  return i;
+}
+
+int
+EIB_MC_Batch (EIBConnection * con, int count, EIBMCRequest * req)
+{
+  int sent = 0, done = 0, index, len;
+
+  if (!con || count < 0 || count > 0xffff || (count && !req))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  while (done < count)
+    {
+      /* keep the window of outstanding requests filled */
+      while (sent < count && sent - done < EIB_MC_BATCH_WINDOW)
+	{
+	  if (sendtagged (con, sent, &req[sent]) == -1)
+	    return -1;
+	  sent++;
+	}
+
+      if (_EIB_GetRequest (con) == -1)
+	return -1;
+      if (EIBTYPE (con) != EIB_MC_TAGGED || con->size < 6)
+	{
+	  /* eibd does not know tagged requests */
+	  errno = EIBTYPE (con) == EIB_INVALID_REQUEST ? ENOTSUP : ECONNRESET;
+	  return -1;
+	}
+      index = (con->buf[2] << 8) | (con->buf[3]);
+      if (index >= sent)
+	{
+	  errno = ECONNRESET;
+	  return -1;
+	}
+      len = con->size - 4;
+      req[index].len = len;
+      if (len > req[index].maxlen)
+	len = req[index].maxlen;
+      if (len > 0 && req[index].buf)
+	memcpy (req[index].buf, con->buf + 4, len);
+      done++;
+    }
+  return 0;
+}
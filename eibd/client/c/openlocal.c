@@ -64,6 +64,8 @@ EIBSocketLocal (const char *path)
   con->buflen = 0;
   con->buf = 0;
   con->readlen = 0;
+  con->dropped = 0;
+  con->ring = 0;
 
   return con;
 }
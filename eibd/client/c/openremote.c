@@ -127,6 +127,8 @@ EIBSocketRemote (const char *host, int port)
   con->buflen = 0;
   con->buf = 0;
   con->readlen = 0;
+  con->dropped = 0;
+  con->ring = 0;
 
   return con;
 }
@@ -37,5 +37,7 @@ EIB_Poll_Complete (EIBConnection * con)
     }
   if (_EIB_CheckRequest (con, 0) == -1)
     return -1;
-  return (con->readlen >= 2 && con->readlen >= con->size + 2) ? 1 : 0;
+  if (con->readlen >= 2 && con->readlen >= con->size + 2)
+    return _EIB_CheckDropped (con) ? 0 : 1;
+  return 0;
 }
@@ -35,5 +35,7 @@ EIB_Poll_FD (EIBConnection * con)
       errno = EINVAL;
       return -1;
     }
+  if (con->ring)
+    return _EIB_RingArm (con) == -1 ? -1 : con->ringfd;
   return con->fd;
 }
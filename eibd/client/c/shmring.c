@@ -0,0 +1,280 @@
+/*
+    EIBD client library
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    In addition to the permissions in the GNU General Public License, 
+    you may link the compiled version of this file into combinations
+    with other programs, and distribute those combinations without any 
+    restriction coming from the use of this file. (The General Public 
+    License restrictions do apply in other respects; for example, they 
+    cover modification of the file, and distribution when not linked into 
+    a combine executable.)
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+
+#include "eibclient-int.h"
+
+/** accesses a 32 bit field of the ring header */
+#define RING_FIELD(con, offset) (*(volatile uint32_t *) ((con)->ring + (offset)))
+
+/** reads exactly len bytes from the socket */
+static int
+readall (EIBConnection * con, uchar * buf, int len)
+{
+  int i;
+  while (len > 0)
+    {
+      i = read (con->fd, buf, len);
+      if (i == -1 && errno == EINTR)
+	continue;
+      if (i == -1)
+	return -1;
+      if (i == 0)
+	{
+	  errno = ECONNRESET;
+	  return -1;
+	}
+      buf += i;
+      len -= i;
+    }
+  return 0;
+}
+
+int
+EIB_Shm_Open (EIBConnection * con, int order)
+{
+  uchar head[3];
+  struct iovec iov;
+  struct msghdr mh;
+  union
+  {
+    struct cmsghdr h;
+    char data[CMSG_SPACE (3 * sizeof (int))];
+  } ctl;
+  struct cmsghdr *cm;
+  int fds[3] = { -1, -1, -1 };
+  unsigned size;
+  int i;
+  void *m;
+
+  if (!con || con->ring || order < 0 || order > 0xff)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  EIBSETTYPE (head, EIB_OPEN_SHM_RING);
+  head[2] = order;
+  if (_EIB_SendRequest (con, 3, head) == -1)
+    return -1;
+
+  /* the descriptors arrive with the first byte of the answer */
+  iov.iov_base = head;
+  iov.iov_len = 2;
+  memset (&mh, 0, sizeof (mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = ctl.data;
+  mh.msg_controllen = sizeof (ctl.data);
+  do
+    i = recvmsg (con->fd, &mh, 0);
+  while (i == -1 && errno == EINTR);
+  if (i == -1)
+    return -1;
+  if (i == 0)
+    {
+      errno = ECONNRESET;
+      return -1;
+    }
+  for (cm = CMSG_FIRSTHDR (&mh); cm; cm = CMSG_NXTHDR (&mh, cm))
+    if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS
+	&& cm->cmsg_len == CMSG_LEN (sizeof (fds)))
+      memcpy (fds, CMSG_DATA (cm), sizeof (fds));
+  if (i < 2 && readall (con, head + i, 2 - i) == -1)
+    goto err;
+  size = (head[0] << 8) | (head[1]);
+  if (size < 2 || size > 3)
+    {
+      errno = ECONNRESET;
+      goto err;
+    }
+  if (readall (con, head, size) == -1)
+    goto err;
+
+  if (((head[0] << 8) | head[1]) == EIB_INVALID_REQUEST)
+    {
+      errno = EOPNOTSUPP;
+      goto err;
+    }
+  if (((head[0] << 8) | head[1]) == EIB_PROCESSING_ERROR)
+    {
+      errno = EINVAL;
+      goto err;
+    }
+  if (((head[0] << 8) | head[1]) != EIB_OPEN_SHM_RING || size != 3
+      || fds[0] == -1 || head[2] < EIB_SHM_RING_MIN_ORDER
+      || head[2] > EIB_SHM_RING_MAX_ORDER)
+    {
+      errno = ECONNRESET;
+      goto err;
+    }
+
+  m = mmap (0, EIB_SHM_RING_HEADER + (1 << head[2]), PROT_READ | PROT_WRITE,
+	    MAP_SHARED, fds[0], 0);
+  if (m == MAP_FAILED)
+    goto err;
+  close (fds[0]);
+  con->ring = (uchar *) m;
+  con->ringsize = 1 << head[2];
+  con->ringpos = RING_FIELD (con, EIB_SHM_RING_TAIL);
+  con->ringfd = fds[1];
+  con->spacefd = fds[2];
+  return 0;
+
+err:
+  for (i = 0; i < 3; i++)
+    if (fds[i] != -1)
+      close (fds[i]);
+  return -1;
+}
+
+int
+_EIB_RingGet (EIBConnection * con, const uchar ** data, int block)
+{
+  uint32_t tail = con->ringpos;
+  uint32_t len;
+  uint64_t v = 1;
+  struct timeval tv;
+  fd_set readset;
+
+  /* release the previous record */
+  if (RING_FIELD (con, EIB_SHM_RING_TAIL) != tail)
+    {
+      __sync_synchronize ();
+      RING_FIELD (con, EIB_SHM_RING_TAIL) = tail;
+      __sync_synchronize ();
+      if (RING_FIELD (con, EIB_SHM_RING_FULL))
+	{
+	  RING_FIELD (con, EIB_SHM_RING_FULL) = 0;
+	  while (write (con->spacefd, &v, sizeof (v)) == -1 && errno == EINTR)
+	    ;
+	}
+    }
+
+  while (1)
+    {
+      if (RING_FIELD (con, EIB_SHM_RING_HEAD) != tail)
+	{
+	  __sync_synchronize ();
+	  len = *(uint32_t *) (con->ring + EIB_SHM_RING_HEADER +
+			       (tail & (con->ringsize - 1)));
+	  if (len == EIB_SHM_RING_WRAP)
+	    {
+	      tail += con->ringsize - (tail & (con->ringsize - 1));
+	      continue;
+	    }
+	  *data = con->ring + EIB_SHM_RING_HEADER +
+	    (tail & (con->ringsize - 1)) + 4;
+	  con->ringpos = tail + 4 + ((len + 3) & ~3);
+	  return len;
+	}
+      if (RING_FIELD (con, EIB_SHM_RING_CLOSED))
+	{
+	  errno = ECONNRESET;
+	  return -1;
+	}
+      if (!block)
+	{
+	  /* clear old signals, so that polling ringfd blocks */
+	  tv.tv_sec = 0;
+	  tv.tv_usec = 0;
+	  FD_ZERO (&readset);
+	  FD_SET (con->ringfd, &readset);
+	  if (select (con->ringfd + 1, &readset, 0, 0, &tv) == -1)
+	    return -1;
+	  if (FD_ISSET (con->ringfd, &readset)
+	      && read (con->ringfd, &v, sizeof (v)) == -1 && errno != EINTR)
+	    return -1;
+	}
+      /* announce the sleep and check again, so no record is missed */
+      RING_FIELD (con, EIB_SHM_RING_WAITING) = 1;
+      __sync_synchronize ();
+      if (RING_FIELD (con, EIB_SHM_RING_HEAD) != tail
+	  || RING_FIELD (con, EIB_SHM_RING_CLOSED))
+	continue;
+      if (!block)
+	return 0;
+      if (read (con->ringfd, &v, sizeof (v)) == -1 && errno != EINTR)
+	return -1;
+    }
+}
+
+int
+_EIB_RingArm (EIBConnection * con)
+{
+  uint64_t v = 1;
+
+  /* eibd only signals a waiting client, so announce the wait now and
+   * keep the descriptor readable, if records arrived before */
+  RING_FIELD (con, EIB_SHM_RING_WAITING) = 1;
+  __sync_synchronize ();
+  if (RING_FIELD (con, EIB_SHM_RING_HEAD) == con->ringpos
+      && !RING_FIELD (con, EIB_SHM_RING_CLOSED))
+    return 0;
+  while (write (con->ringfd, &v, sizeof (v)) == -1)
+    if (errno != EINTR)
+      return -1;
+  return 0;
+}
+
+int
+EIB_Shm_Get (EIBConnection * con, int block, const uint8_t ** buf)
+{
+  const uchar *data;
+  int len;
+
+  if (!con || !con->ring || !buf)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  while (1)
+    {
+      len = _EIB_RingGet (con, &data, block);
+      if (len <= 0)
+	return len;
+      if (len < 2)
+	{
+	  errno = ECONNRESET;
+	  return -1;
+	}
+      /* drop reports are consumed like in all other functions */
+      if (len >= 6 && ((data[0] << 8) | data[1]) == EIB_DROPPED_PACKETS)
+	{
+	  con->dropped = (data[2] << 24) | (data[3] << 16) |
+	    (data[4] << 8) | (data[5]);
+	  continue;
+	}
+      *buf = data;
+      return len;
+    }
+}
@@ -0,0 +1,139 @@
+/*
+    EIB Demo program - measures the frame conversions
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <time.h>
+#include "emi.h"
+
+/** number of heap allocations so far */
+static unsigned long heapallocs = 0;
+
+void *
+operator  new (size_t n) throw (std::bad_alloc)
+{
+  void *p = malloc (n ? n : 1);
+  if (!p)
+    abort ();
+  heapallocs++;
+  return p;
+}
+
+void *
+operator  new[] (size_t n) throw (std::bad_alloc)
+{
+  return operator  new (n);
+}
+
+void
+operator  delete (void *p) throw ()
+{
+  free (p);
+}
+
+void
+operator  delete[] (void *p) throw ()
+{
+  free (p);
+}
+
+/** TP1 frame: GroupValue_Write 1.1.1 -> 1/2/1 */
+static const uchar tp1[] =
+  { 0xBC, 0x11, 0x01, 0x0A, 0x01, 0xE1, 0x00, 0x81, 0x38 };
+/** cEMI L_Data.ind of the same frame */
+static const uchar cemi[] =
+  { 0x29, 0x00, 0xBC, 0xE0, 0x11, 0x01, 0x0A, 0x01, 0x01, 0x00, 0x81 };
+
+/** returns a monotonic time in ns; the benchmark uses no clock of eibd,
+ * so it can be built against older trees for a comparison */
+static double
+now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/** prints time and heap allocations per operation since start */
+static void
+report (const char *name, unsigned long count, double start,
+	unsigned long allocs)
+{
+  double t = now () - start;
+  printf ("%-16s %8.1f ns/op %6.2f allocations/op\n", name,
+	  t / count, (double) (heapallocs - allocs) / count);
+}
+
+int
+main (int ac, char *ag[])
+{
+  unsigned long count = 1000000, i, allocs;
+  double start;
+  CArray tp1frame, cemiframe;
+
+  if (ac > 2)
+    {
+      printf ("usage: %s [count]\n", ag[0]);
+      exit (1);
+    }
+  if (ac == 2)
+    count = strtoul (ag[1], 0, 0);
+  if (!count)
+    {
+      printf ("count must be positive\n");
+      exit (1);
+    }
+  tp1frame.set (tp1, sizeof (tp1));
+  cemiframe.set (cemi, sizeof (cemi));
+
+  allocs = heapallocs;
+  start = now ();
+  for (i = 0; i < count; i++)
+    {
+      L_Data_PDU l;
+      if (!l.init (tp1frame))
+	abort ();
+    }
+  report ("init", count, start, allocs);
+
+  allocs = heapallocs;
+  start = now ();
+  for (i = 0; i < count; i++)
+    {
+      L_Data_PDU l;
+      l.init (tp1frame);
+      CArray c = l.ToPacket ();
+      if (c () != sizeof (tp1))
+	abort ();
+    }
+  report ("init+ToPacket", count, start, allocs);
+
+  allocs = heapallocs;
+  start = now ();
+  for (i = 0; i < count; i++)
+    {
+      L_Data_PDU *l = CEMI_to_L_Data (cemiframe);
+      if (!l)
+	abort ();
+      l->unref ();
+    }
+  report ("CEMI_to_L_Data", count, start, allocs);
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*
+    EIB Demo program - measures the group cache
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "groupcache.h"
+#include "memorylayer2.h"
+
+/** number of distinct group addresses */
+#define ADDRESSES 20000
+/** percentage of updates in the mixed run */
+#define UPDATES 20
+
+/** number of heap allocations so far */
+static unsigned long heapallocs = 0;
+
+void *
+operator  new (size_t n) throw (std::bad_alloc)
+{
+  void *p = malloc (n ? n : 1);
+  if (!p)
+    abort ();
+  heapallocs++;
+  return p;
+}
+
+void *
+operator  new[] (size_t n) throw (std::bad_alloc)
+{
+  return operator  new (n);
+}
+
+void
+operator  delete (void *p) throw ()
+{
+  free (p);
+}
+
+void
+operator  delete[] (void *p) throw ()
+{
+  free (p);
+}
+
+/** group addresses of the benchmark, spread over all main groups */
+static eibaddr_t addrs[ADDRESSES];
+
+/** returns the next pseudo random number */
+static unsigned
+rnd ()
+{
+  static unsigned state = 1;
+  state = state * 1103515245 + 12345;
+  return state >> 8;
+}
+
+/** passes a GroupValue_Write of value to dst to the cache */
+static void
+update (GroupCache * cache, L_Data_PDU * l, eibaddr_t dst, unsigned value)
+{
+  l->dest = dst;
+  l->data[2] = value & 0xff;
+  l->data[3] = (value >> 8) & 0xff;
+  /* the cache releases its reference */
+  l->ref ();
+  cache->Get_L_Data (l);
+}
+
+/** prints time and heap allocations per operation since start */
+static void
+report (const char *name, unsigned long count, timestamp_t start,
+	unsigned long allocs)
+{
+  timestamp_t t = getMonotonicTime () - start;
+  printf ("%-8s %8.1f ns/op %6.2f allocations/op\n", name,
+	  (double) t / count, (double) (heapallocs - allocs) / count);
+}
+
+int
+main (int ac, char *ag[])
+{
+  unsigned long count = 1000000, i, allocs, reads = 0, found = 0;
+  timestamp_t start;
+  Trace t;
+
+  if (ac > 2)
+    {
+      printf ("usage: %s [count]\n", ag[0]);
+      exit (1);
+    }
+  if (ac == 2)
+    count = strtoul (ag[1], 0, 0);
+  if (!count)
+    {
+      printf ("count must be positive\n");
+      exit (1);
+    }
+
+  pth_init ();
+  Layer3 *l3 = new Layer3 (new MemoryLayer2 (0x1000), &t);
+  GroupCache *cache = new GroupCache (l3, &t);
+  if (!cache->Start ())
+    {
+      printf ("starting the group cache failed\n");
+      exit (1);
+    }
+  for (i = 0; i < ADDRESSES; i++)
+    addrs[i] = (i * 0xfff1 + 0x0801) & 0xffff;
+
+  L_Data_PDU *l = new L_Data_PDU;
+  l->source = 0x1001;
+  l->AddrType = GroupAddress;
+  l->data.resize (4);
+  l->data[0] = 0x00;
+  l->data[1] = 0x80;
+
+  /* warm-up: one value for each address */
+  allocs = heapallocs;
+  start = getMonotonicTime ();
+  for (i = 0; i < ADDRESSES; i++)
+    update (cache, l, addrs[i], i);
+  report ("warm-up", ADDRESSES, start, allocs);
+
+  allocs = heapallocs;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      reads++;
+      if (cache->Get (addrs[rnd () % ADDRESSES], 0))
+	found++;
+    }
+  report ("read", count, start, allocs);
+
+  allocs = heapallocs;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    update (cache, l, addrs[rnd () % ADDRESSES], i);
+  report ("update", count, start, allocs);
+
+  allocs = heapallocs;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      unsigned r = rnd ();
+      if (r % 100 < UPDATES)
+	update (cache, l, addrs[(r / 100) % ADDRESSES], i);
+      else
+	{
+	  reads++;
+	  if (cache->Get (addrs[(r / 100) % ADDRESSES], 0))
+	    found++;
+	}
+    }
+  report ("mixed", count, start, allocs);
+
+  printf ("%lu of %lu reads found a value\n", found, reads);
+
+  l->unref ();
+  delete cache;
+  delete l3;
+  pth_exit (0);
+  return 0;
+}
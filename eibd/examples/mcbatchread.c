@@ -0,0 +1,113 @@
+/*
+    EIB Demo program - compare single and batched memory reads
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/time.h>
+#include "common.h"
+#include "eibtypes.h"
+
+/** returns the seconds since start */
+static double
+elapsed (struct timeval *start)
+{
+  struct timeval now;
+  gettimeofday (&now, 0);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec -
+					  start->tv_usec) / 1000000.0;
+}
+
+int
+main (int ac, char *ag[])
+{
+  int len, addr, count = 200, i;
+  EIBConnection *con;
+  EIBMCRequest *req;
+  uchar *reqbuf, *ansbuf;
+  uchar buf[255];
+  eibaddr_t dest;
+  struct timeval start;
+  double single, batch;
+  char *prog = ag[0];
+
+  parseKey (&ac, &ag);
+  if (ac != 5 && ac != 6)
+    die ("usage: %s url [-k key] eibaddr addr len [count]", prog);
+  con = EIBSocketURL (ag[1]);
+  if (!con)
+    die ("Open failed");
+  dest = readaddr (ag[2]);
+  addr = readHex (ag[3]);
+  len = atoi (ag[4]);
+  if (ac == 6)
+    count = atoi (ag[5]);
+  if (len < 1 || len > 250 || count < 1 || count > 0xffff)
+    die ("invalid len or count");
+
+  if (EIB_MC_Connect (con, dest) == -1)
+    die ("Connect failed");
+  auth (con);
+
+  /* one request after the other */
+  gettimeofday (&start, 0);
+  for (i = 0; i < count; i++)
+    if (EIB_MC_Read (con, (addr + i * len) & 0xffff, len, buf) == -1)
+      die ("Read failed");
+  single = elapsed (&start);
+
+  /* the same reads as one batch */
+  req = (EIBMCRequest *) malloc (count * sizeof (EIBMCRequest));
+  reqbuf = (uchar *) malloc (count * 6);
+  ansbuf = (uchar *) malloc (count * (len + 2));
+  if (!req || !reqbuf || !ansbuf)
+    die ("out of memory");
+  for (i = 0; i < count; i++)
+    {
+      uchar *r = reqbuf + i * 6;
+      r[0] = (EIB_MC_READ >> 8) & 0xff;
+      r[1] = (EIB_MC_READ) & 0xff;
+      r[2] = ((addr + i * len) >> 8) & 0xff;
+      r[3] = (addr + i * len) & 0xff;
+      r[4] = (len >> 8) & 0xff;
+      r[5] = (len) & 0xff;
+      req[i].req = r;
+      req[i].req_len = 6;
+      req[i].buf = ansbuf + i * (len + 2);
+      req[i].maxlen = len + 2;
+      req[i].len = 0;
+    }
+  gettimeofday (&start, 0);
+  if (EIB_MC_Batch (con, count, req) == -1)
+    die ("Batch failed");
+  batch = elapsed (&start);
+  for (i = 0; i < count; i++)
+    if (req[i].len != len + 2
+	|| ((req[i].buf[0] << 8) | req[i].buf[1]) != EIB_MC_READ)
+      die ("Batch read %d failed", i);
+
+  printf ("%d x EIB_MC_Read: %.3f s (%.1f ms per read)\n", count, single,
+	  single * 1000 / count);
+  printf ("EIB_MC_Batch of %d reads: %.3f s (%.1f ms per read)\n", count,
+	  batch, batch * 1000 / count);
+  if (batch > 0)
+    printf ("speedup: %.2f\n", single / batch);
+
+  free (req);
+  free (reqbuf);
+  free (ansbuf);
+  EIBClose (con);
+  return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    EIB Demo program - backend for the benchmarks of the server stack
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef MEMORYLAYER2_H
+#define MEMORYLAYER2_H
+
+#include "layer2.h"
+
+/** backend, which keeps its frames in memory */
+class MemoryLayer2:public Layer2Interface
+{
+  /** frames to be received */
+  Queue < LPDU * >inqueue;
+  /** semaphore for inqueue */
+  pth_sem_t insignal;
+  /** default address */
+  eibaddr_t addr;
+public:
+  /** frames sent to this line */
+  unsigned long sent;
+  /** number of sent frames, which increments done */
+  unsigned long target;
+  /** incremented, when target frames are sent */
+  pth_sem_t done;
+
+    MemoryLayer2 (eibaddr_t a)
+  {
+    addr = a;
+    sent = 0;
+    target = 0;
+    pth_sem_init (&insignal);
+    pth_sem_init (&done);
+  }
+  ~MemoryLayer2 ()
+  {
+    while (!inqueue.isempty ())
+      inqueue.get ()->unref ();
+  }
+  /** queues l as received from the line */
+  void inject (LPDU * l)
+  {
+    inqueue.put (l);
+    pth_sem_inc (&insignal, 0);
+  }
+
+  bool init ()
+  {
+    return 1;
+  }
+  void Send_L_Data (LPDU * l)
+  {
+    l->unref ();
+    if (++sent == target)
+      pth_sem_inc (&done, 0);
+  }
+  LPDU *Get_L_Data (pth_event_t stop)
+  {
+    pth_event_t getwait = pth_event (PTH_EVENT_SEM, &insignal);
+    LPDU *l = 0;
+    if (stop != NULL)
+      pth_event_concat (getwait, stop, NULL);
+    pth_wait (getwait);
+    if (stop)
+      pth_event_isolate (getwait);
+    if (pth_event_status (getwait) == PTH_STATUS_OCCURRED)
+      {
+	pth_sem_dec (&insignal);
+	l = inqueue.get ();
+      }
+    pth_event_free (getwait, PTH_FREE_THIS);
+    return l;
+  }
+  bool addAddress (eibaddr_t addr)
+  {
+    return 1;
+  }
+  bool addGroupAddress (eibaddr_t addr)
+  {
+    return 1;
+  }
+  bool removeAddress (eibaddr_t addr)
+  {
+    return 1;
+  }
+  bool removeGroupAddress (eibaddr_t addr)
+  {
+    return 1;
+  }
+  bool enterBusmonitor ()
+  {
+    return 1;
+  }
+  bool leaveBusmonitor ()
+  {
+    return 1;
+  }
+  bool openVBusmonitor ()
+  {
+    return 1;
+  }
+  bool closeVBusmonitor ()
+  {
+    return 1;
+  }
+  bool Open ()
+  {
+    return 1;
+  }
+  bool Close ()
+  {
+    return 1;
+  }
+  eibaddr_t getDefaultAddr ()
+  {
+    return addr;
+  }
+  bool Connection_Lost ()
+  {
+    return 0;
+  }
+  bool Send_Queue_Empty ()
+  {
+    return 1;
+  }
+};
+
+#endif
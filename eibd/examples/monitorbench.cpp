@@ -0,0 +1,110 @@
+/*
+    EIB Demo program - measures the busmonitor text formats
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "busmonitor.h"
+
+/** number of frames formatted with one clock offset, as by one flush */
+#define BATCH 64
+
+/** GroupValue_Write 1.1.1 -> 1/2/1 */
+static const uchar groupwrite[] =
+  { 0xBC, 0x11, 0x01, 0x0A, 0x01, 0xE1, 0x00, 0x81, 0x38 };
+/** A_Memory_Read 1.1.1 -> 1.1.5 */
+static const uchar memread[] =
+  { 0xB0, 0x11, 0x01, 0x11, 0x05, 0x65, 0x03, 0xD1, 0x00, 0x22, 0xDE };
+/** acknowledge */
+static const uchar ack[] = { 0xCC };
+
+/** prints the time per frame since start */
+static void
+report (const char *name, unsigned long count, timestamp_t start,
+	unsigned long bytes)
+{
+  timestamp_t t = getMonotonicTime () - start;
+  printf ("%-8s %8.0f ns/frame %10.0f frames/s %6.1f bytes/frame\n", name,
+	  (double) t / count, t > 0 ? count * 1e9 / t : 0,
+	  (double) bytes / count);
+}
+
+int
+main (int ac, char *ag[])
+{
+  unsigned long count = 1000000, i, bytes;
+  L_Busmonitor_PDU *frames[3];
+  Text_Busmonitor_Formatter formatter;
+  timestamp_t start;
+
+  if (ac > 2)
+    {
+      printf ("usage: %s [count]\n", ag[0]);
+      exit (1);
+    }
+  if (ac == 2)
+    count = strtoul (ag[1], 0, 0);
+  if (!count)
+    {
+      printf ("count must be positive\n");
+      exit (1);
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      frames[i] = new L_Busmonitor_PDU;
+      frames[i]->arrival = getMonotonicTime ();
+    }
+  frames[0]->pdu.set (groupwrite, sizeof (groupwrite));
+  frames[1]->pdu.set (memread, sizeof (memread));
+  frames[2]->pdu.set (ack, sizeof (ack));
+
+  /* EIB_BUSMONITOR_FORMAT_DECODE builds a String per frame */
+  bytes = 0;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      String s = frames[i % 3]->Decode ();
+      bytes += strlen (s ()) + 3;
+    }
+  report ("decode", count, start, bytes);
+
+  bytes = 0;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      if (i % BATCH == 0)
+	formatter.updateClock ();
+      bytes += formatter.formatTable (frames[i % 3]);
+    }
+  report ("table", count, start, bytes);
+
+  bytes = 0;
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      if (i % BATCH == 0)
+	formatter.updateClock ();
+      bytes += formatter.formatJSON (frames[i % 3]);
+    }
+  report ("json", count, start, bytes);
+
+  for (i = 0; i < 3; i++)
+    frames[i]->unref ();
+  return 0;
+}
@@ -0,0 +1,131 @@
+/*
+    EIB Demo program - measures the queues between backend and Layer 3
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "layer3.h"
+#include "memorylayer2.h"
+
+/** frames queued in the backend before they are awaited */
+#define BATCH 256
+
+/** counts the frames delivered by Layer 3 */
+class CountCallBack:public L_Data_CallBack
+{
+public:
+  /** delivered frames */
+  unsigned long count;
+  /** number of delivered frames, which increments done */
+  unsigned long target;
+  /** incremented, when target frames are delivered */
+  pth_sem_t done;
+
+    CountCallBack ()
+  {
+    count = 0;
+    target = 0;
+    pth_sem_init (&done);
+  }
+  void Get_L_Data (L_Data_PDU * l)
+  {
+    l->unref ();
+    if (++count == target)
+      pth_sem_inc (&done, 0);
+  }
+};
+
+/** prints the rate of count elements since start */
+static void
+report (const char *name, unsigned long count, timestamp_t start)
+{
+  timestamp_t t = getMonotonicTime () - start;
+  printf ("%-8s %lu frames in %.3f s: %.0f frames/s, %.0f ns/frame\n", name,
+	  count, t / 1e9, t > 0 ? count * 1e9 / t : 0, (double) t / count);
+}
+
+int
+main (int ac, char *ag[])
+{
+  unsigned long count = 1000000, i, j;
+  Trace t;
+  CountCallBack cb;
+
+  if (ac > 2)
+    {
+      printf ("usage: %s [count]\n", ag[0]);
+      exit (1);
+    }
+  if (ac == 2)
+    count = strtoul (ag[1], 0, 0);
+  if (!count)
+    {
+      printf ("count must be positive\n");
+      exit (1);
+    }
+
+  /* the queue alone, in steady state without allocations */
+  Queue < LPDU * >q (BATCH);
+  L_Data_PDU *f = new L_Data_PDU;
+  timestamp_t start = getMonotonicTime ();
+  for (i = 0; i < count; i += BATCH)
+    {
+      for (j = 0; j < BATCH; j++)
+	q.put (f);
+      for (j = 0; j < BATCH; j++)
+	q.get ();
+    }
+  report ("queue", i, start);
+  f->unref ();
+
+  /* backend queue, Layer 3 queue and dispatch to a group callback */
+  pth_init ();
+  MemoryLayer2 *l2 = new MemoryLayer2 (0x1000);
+  Layer3 *l3 = new Layer3 (l2, &t);
+  if (!l3->registerGroupCallBack (&cb, 0))
+    {
+      printf ("registering the callback failed\n");
+      exit (1);
+    }
+  pth_event_t done = pth_event (PTH_EVENT_SEM, &cb.done);
+  start = getMonotonicTime ();
+  for (i = 0; i < count; i += BATCH)
+    {
+      for (j = 0; j < BATCH; j++)
+	{
+	  L_Data_PDU *l = new L_Data_PDU;
+	  l->source = 0x1001;
+	  l->dest = 0x0801;
+	  l->AddrType = GroupAddress;
+	  l->data.resize (2);
+	  l->data[0] = 0x00;
+	  l->data[1] = 0x80 | (j & 0x3f);
+	  l2->inject (l);
+	}
+      cb.target = i + BATCH;
+      pth_wait (done);
+      pth_sem_dec (&cb.done);
+    }
+  report ("layer3", i, start);
+  pth_event_free (done, PTH_FREE_THIS);
+
+  l3->deregisterGroupCallBack (&cb, 0);
+  delete l3;
+  pth_exit (0);
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+    EIB Demo program - compare the socket with the shared memory ring
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "common.h"
+
+/** frames sent before their reception is awaited */
+#define WINDOW 100
+
+/** returns the seconds of tv */
+static double
+seconds (const struct timeval *tv)
+{
+  return tv->tv_sec + tv->tv_usec / 1000000.0;
+}
+
+/** returns the CPU time of this process in seconds */
+static double
+cputime ()
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return seconds (&ru.ru_utime) + seconds (&ru.ru_stime);
+}
+
+/** waits for the next group frame to dest, returns -1 on error */
+static int
+receive (EIBConnection * con, int ring, eibaddr_t dest)
+{
+  uchar buf[255];
+  const uint8_t *msg;
+  eibaddr_t src, dst;
+  int len;
+
+  do
+    {
+      if (ring)
+	{
+	  /* type, source, destination and APDU without a copy */
+	  len = EIB_Shm_Get (con, 1, &msg);
+	  if (len == -1)
+	    return -1;
+	  if (len < 6)
+	    continue;
+	  dst = (msg[4] << 8) | msg[5];
+	}
+      else
+	{
+	  len = EIBGetGroup_Src (con, sizeof (buf), buf, &src, &dst);
+	  if (len == -1)
+	    return -1;
+	}
+    }
+  while (dst != dest);
+  return 0;
+}
+
+/** sends count group writes to dest and receives them over the socket
+ * or the ring; prints the throughput */
+static void
+run (const char *url, int ring, eibaddr_t dest, int count)
+{
+  EIBConnection *tx, *rx;
+  struct timeval start, end;
+  double cpu, wall;
+  uchar apdu[3] = { 0x00, 0x80, 0x00 };
+  int sent = 0, received = 0;
+
+  rx = EIBSocketURL (url);
+  tx = EIBSocketURL (url);
+  if (!rx || !tx)
+    die ("Open failed");
+  if (ring && EIB_Shm_Open (rx, 0) == -1)
+    die ("Opening the ring failed");
+  if (EIBOpen_GroupSocket (rx, 0) == -1 || EIBOpen_GroupSocket (tx, 1) == -1)
+    die ("Connect failed");
+
+  gettimeofday (&start, 0);
+  cpu = cputime ();
+  while (received < count)
+    {
+      while (sent < count && sent - received < WINDOW)
+	{
+	  apdu[2] = sent & 0xff;
+	  if (EIBSendGroup (tx, dest, sizeof (apdu), apdu) == -1)
+	    die ("Send failed");
+	  sent++;
+	}
+      if (receive (rx, ring, dest) == -1)
+	die ("Read failed");
+      received++;
+    }
+  cpu = cputime () - cpu;
+  gettimeofday (&end, 0);
+  wall = seconds (&end) - seconds (&start);
+
+  printf ("%-6s %d frames in %.3f s: %.0f frames/s, %.2f us CPU/frame\n",
+	  ring ? "ring" : "socket", count, wall, wall > 0 ? count / wall : 0,
+	  cpu * 1000000 / count);
+  EIBClose (tx);
+  EIBClose (rx);
+}
+
+int
+main (int ac, char *ag[])
+{
+  int count = 10000;
+  eibaddr_t dest;
+
+  if (ac != 3 && ac != 4)
+    die ("usage: %s url groupaddr [count]", ag[0]);
+  dest = readgaddr (ag[2]);
+  if (ac == 4)
+    count = atoi (ag[3]);
+  if (count < 1)
+    die ("invalid count");
+
+  run (ag[1], 0, dest, count);
+  run (ag[1], 1, dest, count);
+  return 0;
+}
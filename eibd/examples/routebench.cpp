@@ -0,0 +1,81 @@
+/*
+    EIB Demo program - measures the routing of Layer 3
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "layer3.h"
+#include "memorylayer2.h"
+
+int
+main (int ac, char *ag[])
+{
+  unsigned long count = 100000, i;
+  Trace t;
+
+  if (ac > 2)
+    {
+      printf ("usage: %s [count]\n", ag[0]);
+      exit (1);
+    }
+  if (ac == 2)
+    count = strtoul (ag[1], 0, 0);
+  if (!count)
+    {
+      printf ("count must be positive\n");
+      exit (1);
+    }
+
+  pth_init ();
+  MemoryLayer2 *line0 = new MemoryLayer2 (0x1000);
+  MemoryLayer2 *line1 = new MemoryLayer2 (0x1100);
+  Layer3 *l3 = new Layer3 (line0, &t);
+  if (!l3->addLayer2 (line1))
+    {
+      printf ("adding the second line failed\n");
+      exit (1);
+    }
+  line1->target = count;
+
+  /* GroupValue_Write frames from line 0, all forwarded to line 1 */
+  timestamp_t start = getMonotonicTime ();
+  for (i = 0; i < count; i++)
+    {
+      L_Data_PDU *l = new L_Data_PDU;
+      l->source = 0x1001 + (i & 0xff);
+      l->dest = 0x0800 + (i & 0x7ff);
+      l->AddrType = GroupAddress;
+      l->hopcount = 6;
+      l->data.resize (2);
+      l->data[0] = 0x00;
+      l->data[1] = 0x80 | (i & 0x3f);
+      line0->inject (l);
+    }
+  pth_event_t done = pth_event (PTH_EVENT_SEM, &line1->done);
+  pth_wait (done);
+  pth_event_free (done, PTH_FREE_THIS);
+  timestamp_t end = getMonotonicTime ();
+
+  double secs = (end - start) / 1e9;
+  printf ("%lu frames routed in %.3f s: %.0f frames/s\n", count, secs,
+	  secs > 0 ? count / secs : 0);
+
+  delete l3;
+  pth_exit (0);
+  return 0;
+}
@@ -40,6 +40,74 @@ typedef struct _EIBConnection EIBConnection;
 /** type for storing a EIB address */
 typedef uint16_t eibaddr_t;
 
+/** a request of EIB_MC_Batch */
+typedef struct
+{
+  /** request: message type (EIB_MC_*, 2 bytes) followed by its parameters */
+  const uint8_t *req;
+  /** length of req */
+  int req_len;
+  /** buffer for the answer: message type (2 bytes) followed by its data */
+  uint8_t *buf;
+  /** size of buf */
+  int maxlen;
+  /** length of the answer, set by EIB_MC_Batch; only maxlen bytes of it are stored in buf */
+  int len;
+} EIBMCRequest;
+
+/** EIB_Cache_ReadMulti: read uncached single addresses from the bus */
+#define EIB_CACHE_READ_MULTI_FETCH      0x01
+/** EIB_Cache_ReadMulti: not all values fitted into the answer */
+#define EIB_CACHE_READ_MULTI_TRUNCATED  0x01
+/** EIB_Cache_History: not all values fitted into the answer */
+#define EIB_CACHE_HISTORY_TRUNCATED     0x01
+/** EIB_Cache_Scan: copy all values at once before sending them */
+#define EIB_CACHE_SCAN_SNAPSHOT         0x01
+/** EIB_Cache_Scan answer: no further answer follows */
+#define EIB_CACHE_SCAN_LAST             0x01
+
+/** filter item: group addresses from start to end,
+ * followed by start (2 bytes) and end (2 bytes) */
+#define EIB_FILTER_GROUP_RANGE          0x01
+/** filter item: bitmap of group addresses, followed by the first
+ * group address (2 bytes), the bitmap length (1 byte) and the bitmap;
+ * bit n (LSB first) stands for the first group address + n */
+#define EIB_FILTER_GROUP_BITMAP         0x02
+/** filter item: source addresses, followed by address (2 bytes) and mask (2 bytes) */
+#define EIB_FILTER_SOURCE               0x03
+/** filter item: APCI classes, followed by EIB_FILTER_APCI_* (1 byte) */
+#define EIB_FILTER_APCI                 0x04
+/** filter item: busmonitor frame types, followed by EIB_FILTER_FRAME_* (1 byte) */
+#define EIB_FILTER_FRAME                0x05
+/** EIB_FILTER_APCI: A_GroupValue_Read */
+#define EIB_FILTER_APCI_READ            0x01
+/** EIB_FILTER_APCI: A_GroupValue_Response */
+#define EIB_FILTER_APCI_RESPONSE        0x02
+/** EIB_FILTER_APCI: A_GroupValue_Write */
+#define EIB_FILTER_APCI_WRITE           0x04
+/** EIB_FILTER_APCI: all other services */
+#define EIB_FILTER_APCI_OTHER           0x08
+/** EIB_FILTER_FRAME: data frames */
+#define EIB_FILTER_FRAME_DATA           0x01
+/** EIB_FILTER_FRAME: acknowledgements (ACK, NACK, BUSY) */
+#define EIB_FILTER_FRAME_ACK            0x02
+/** EIB_FILTER_FRAME: all other frames */
+#define EIB_FILTER_FRAME_OTHER          0x04
+
+/** busmonitor format: decoded frames, as EIBOpenBusmonitorText */
+#define EIB_BUSMONITOR_FORMAT_DECODE    0x00
+/** busmonitor format: one fixed-width line per frame:
+ * time, type, priority, repeat flag, source, destination, hop count,
+ * service and the frame in hex; the time is the system time of the
+ * arrival in eibd in seconds since the epoch, with microseconds */
+#define EIB_BUSMONITOR_FORMAT_TABLE     0x01
+/** busmonitor format: one JSON object per frame on a single line,
+ * with the same fields and time as EIB_BUSMONITOR_FORMAT_TABLE */
+#define EIB_BUSMONITOR_FORMAT_JSON      0x02
+
+/** EIB_MC_Batch: maximum number of requests sent ahead of their answers */
+#define EIB_MC_BATCH_WINDOW             32
+
 /** Opens a connection to eibd.
  *   url can either be <code>ip:host:[port]</code> or <code>local:/path/to/socket</code>
  * \param url contains the url to connect to
@@ -92,6 +160,37 @@ int EIB_Poll_Complete (EIBConnection * con);
  */
 int EIB_Poll_FD (EIBConnection * con);
 
+/** Returns the number of packets, which eibd dropped for this connection, because its receive queue was full.
+ * eibd reports the count before the next packet, which it delivers.
+ * \param con eibd connection
+ * \param count pointer, where to store the count
+ * \return 0 if successful, -1 if error
+ */
+int EIB_Dropped_Packets (EIBConnection * con, uint32_t * count);
+
+/** Switches the messages from eibd to a shared memory ring.
+ * This is only possible for connections over a local socket. Afterwards, eibd
+ * writes all messages into memory shared with the client instead of the socket.
+ * All functions work as before; EIB_Shm_Get additionally returns the messages
+ * without copying them. EIB_Poll_FD returns a file descriptor, which becomes
+ * readable when messages are pending; call it again before each wait.
+ * \param con eibd connection
+ * \param order log2 of the ring size (EIB_SHM_RING_MIN_ORDER to EIB_SHM_RING_MAX_ORDER), 0 for the default
+ * \return 0 if successful, -1 if error
+ */
+int EIB_Shm_Open (EIBConnection * con, int order);
+
+/** Returns the next message from the shared memory ring without copying it.
+ * The message starts with its 2 byte type code, as sent by eibd. It stays valid
+ * until the next call of a function, which receives a message. It must not be
+ * mixed with EIB_Poll_Complete on the same connection.
+ * \param con eibd connection
+ * \param block if null, return 0 instead of waiting for a message
+ * \param buf pointer, where to store the address of the message
+ * \return length of the message, 0 if none is available or -1 if error
+ */
+int EIB_Shm_Get (EIBConnection * con, int block, const uint8_t ** buf);
+
 /** Switches the connection to pristine state
  * \param con eibd connection
  * \return 0 if successful, -1 if error
@@ -128,6 +227,20 @@ int EIBOpenBusmonitorText (EIBConnection * con);
  */
 int EIBOpenBusmonitorText_async (EIBConnection * con);
 
+/** Switches the connection to text busmonitor mode with a selectable format.
+ * \param con eibd connection
+ * \param format EIB_BUSMONITOR_FORMAT_*
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpenBusmonitorFormat (EIBConnection * con, uint8_t format);
+
+/** Switches the connection to text busmonitor mode with a selectable format - asynchronous.
+ * \param con eibd connection
+ * \param format EIB_BUSMONITOR_FORMAT_*
+ * \return 0 if started, -1 if error
+ */
+int EIBOpenBusmonitorFormat_async (EIBConnection * con, uint8_t format);
+
 /** Switches the connection to binary busmonitor mode.
  * \param con eibd connection
  * \param timebase if not null, tick length in ns is stored at this location - it is 0, if not provided by the interface
@@ -142,6 +255,26 @@ int EIBOpenBusmonitorTS (EIBConnection * con, uint32_t * timebase);
  */
 int EIBOpenBusmonitorTS_async (EIBConnection * con, uint32_t * timebase);
 
+/** Switches the connection to binary busmonitor mode, delivering only frames accepted by a filter.
+ * The filter is a sequence of EIB_FILTER_* items. Items of the same kind are
+ * alternatives, items of different kinds must all match.
+ * \param con eibd connection
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpenBusmonitor_Filter (EIBConnection * con, int filter_len,
+			      const uint8_t * filter);
+
+/** Switches the connection to binary busmonitor mode, delivering only frames accepted by a filter - asynchronous.
+ * \param con eibd connection
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if started, -1 if error
+ */
+int EIBOpenBusmonitor_Filter_async (EIBConnection * con, int filter_len,
+				    const uint8_t * filter);
+
 /** Switches the connection to binary vbusmonitor mode.
  * \param con eibd connection
  * \return 0 if successful, -1 if error
@@ -166,6 +299,20 @@ int EIBOpenVBusmonitorText (EIBConnection * con);
  */
 int EIBOpenVBusmonitorText_async (EIBConnection * con);
 
+/** Switches the connection to text vbusmonitor mode with a selectable format.
+ * \param con eibd connection
+ * \param format EIB_BUSMONITOR_FORMAT_*
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpenVBusmonitorFormat (EIBConnection * con, uint8_t format);
+
+/** Switches the connection to text vbusmonitor mode with a selectable format - asynchronous.
+ * \param con eibd connection
+ * \param format EIB_BUSMONITOR_FORMAT_*
+ * \return 0 if started, -1 if error
+ */
+int EIBOpenVBusmonitorFormat_async (EIBConnection * con, uint8_t format);
+
 /** Switches the connection to binary busmonitor mode.
  * \param con eibd connection
  * \param timebase if not null, tick length in ns is stored at this location - it is 0, if not provided by the interface
@@ -180,6 +327,26 @@ int EIBOpenVBusmonitorTS (EIBConnection * con, uint32_t * timebase);
  */
 int EIBOpenVBusmonitorTS_async (EIBConnection * con, uint32_t * timebase);
 
+/** Switches the connection to binary vbusmonitor mode, delivering only frames accepted by a filter.
+ * The filter is a sequence of EIB_FILTER_* items. Items of the same kind are
+ * alternatives, items of different kinds must all match.
+ * \param con eibd connection
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpenVBusmonitor_Filter (EIBConnection * con, int filter_len,
+			       const uint8_t * filter);
+
+/** Switches the connection to binary vbusmonitor mode, delivering only frames accepted by a filter - asynchronous.
+ * \param con eibd connection
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if started, -1 if error
+ */
+int EIBOpenVBusmonitor_Filter_async (EIBConnection * con, int filter_len,
+				     const uint8_t * filter);
+
 /** Receives a packet on a busmonitor connection.
  * \param con eibd connection
  * \param maxlen size of the buffer
@@ -191,7 +358,7 @@ int EIBGetBusmonitorPacket (EIBConnection * con, int maxlen, uint8_t * buf);
 /** Receives a packet on a busmonitor connection.
  * \param con eibd connection
  * \param status stores KNX busmonitor status field
- * \param timestamp stores relative timestamp
+ * \param timestamp stores the arrival time in microseconds of a monotonic clock of eibd (wraps after 2^32)
  * \param maxlen size of the buffer
  * \param buf buffer
  * \return -1 if error, else length of the packet
@@ -336,6 +503,28 @@ int EIBOpen_GroupSocket (EIBConnection * con, int write_only);
  */
 int EIBOpen_GroupSocket_async (EIBConnection * con, int write_only);
 
+/** Opens a Group communication interface, delivering only packets accepted by a filter.
+ * The filter is a sequence of EIB_FILTER_* items. Items of the same kind are
+ * alternatives, items of different kinds must all match.
+ * \param con eibd connection
+ * \param write_only if not null, no packets from the bus will be delivered
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpen_GroupSocket_Filter (EIBConnection * con, int write_only,
+				int filter_len, const uint8_t * filter);
+
+/** Opens a Group communication interface, delivering only packets accepted by a filter - asynchronous.
+ * \param con eibd connection
+ * \param write_only if not null, no packets from the bus will be delivered
+ * \param filter_len length of filter
+ * \param filter filter items
+ * \return 0 if started, -1 if error
+ */
+int EIBOpen_GroupSocket_Filter_async (EIBConnection * con, int write_only,
+				      int filter_len, const uint8_t * filter);
+
 /** Sends a group APDU.
  * \param con eibd connection
  * \param dest destination address
@@ -786,6 +975,18 @@ int EIB_MC_Write_Plain (EIBConnection * con, uint16_t addr, int len,
 int EIB_MC_Write_Plain_async (EIBConnection * con, uint16_t addr, int len,
 			      const uint8_t * buf);
 
+/** Executes many requests over a management or individual connection without waiting for each answer.
+ * The requests are tagged with their index (EIB_MC_TAGGED) and sent ahead, up to EIB_MC_BATCH_WINDOW
+ * at a time, so eibd executes them back-to-back. Each answer is stored in the buffer of its request;
+ * a failed request gets an answer of type EIB_INVALID_REQUEST, EIB_PROCESSING_ERROR or EIB_ERROR_VERIFY,
+ * as the corresponding single function would report it.
+ * \param con eibd connection
+ * \param count number of requests (at most 65535)
+ * \param req requests
+ * \return 0 if successful, -1 if error
+ */
+int EIB_MC_Batch (EIBConnection * con, int count, EIBMCRequest * req);
+
 
 /** Loads a BCU SDK program image (over a management connection).
  * \param con eibd connection
@@ -928,6 +1129,195 @@ int EIB_Cache_LastUpdates_async (EIBConnection * con, uint16_t start,
 				 uint8_t timeout, int max_len, uint8_t * buf,
 				 uint16_t * end);
 
+/** Returns the group addresses, whose value changed since the last call on this connection.
+ * The first call returns the changes from then on.
+ * \param con eibd connection
+ * \param timeout how many seconds to wait for a change
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the group addresses (2 bytes each)
+ * \param lost pointer, where to store the number of changes, which were lost, as the connection fell behind
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Cache_Changes (EIBConnection * con, uint8_t timeout, int maxlen,
+		       uint8_t * buf, uint32_t * lost);
+
+/** Returns the group addresses, whose value changed since the last call on this connection - asynchronous.
+ * \param con eibd connection
+ * \param timeout how many seconds to wait for a change
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the group addresses (2 bytes each)
+ * \param lost pointer, where to store the number of changes, which were lost, as the connection fell behind
+ * \return 0 if started, -1 if error
+ */
+int EIB_Cache_Changes_async (EIBConnection * con, uint8_t timeout,
+			     int maxlen, uint8_t * buf, uint32_t * lost);
+
+/** Switches the connection to group cache feed mode.
+ * eibd sends each change of the group cache, which can be read with EIBGetCacheUpdate.
+ * Lost changes are reported by EIB_Dropped_Packets. This includes changes with values longer
+ * than 14 bytes, which were already replaced in the cache when they were sent.
+ * \param con eibd connection
+ * \return 0 if successful, -1 if error
+ */
+int EIBOpenCacheFeed (EIBConnection * con);
+
+/** Switches the connection to group cache feed mode - asynchronous.
+ * \param con eibd connection
+ * \return 0 if started, -1 if error
+ */
+int EIBOpenCacheFeed_async (EIBConnection * con);
+
+/** Receives a group cache change (blocking).
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the value
+ * \param dest pointer, where to store the group address
+ * \param src pointer, where to store the source address
+ * \param recvtime pointer, where to store the receive time (seconds since the epoch)
+ * \return length of the value or -1 if error
+ */
+int EIBGetCacheUpdate (EIBConnection * con, int maxlen, uint8_t * buf,
+		       eibaddr_t * dest, eibaddr_t * src,
+		       uint32_t * recvtime);
+
+/** Receives a group cache change - asynchronous.
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the value
+ * \param dest pointer, where to store the group address
+ * \param src pointer, where to store the source address
+ * \param recvtime pointer, where to store the receive time (seconds since the epoch)
+ * \return 0 if started, -1 if error
+ */
+int EIBGetCacheUpdate_async (EIBConnection * con, int maxlen, uint8_t * buf,
+			     eibaddr_t * dest, eibaddr_t * src,
+			     uint32_t * recvtime);
+
+/** Query the cached values of a list of group address ranges at once.
+ * ranges holds pairs of the first and last group address of a range (2 bytes each, big endian).
+ * The answer starts with a flag byte (EIB_CACHE_READ_MULTI_TRUNCATED), followed by one record
+ * for each cached group address: group address (2 bytes), source address (2 bytes),
+ * age in seconds (2 bytes), value length (1 byte), value.
+ * \param con eibd connection
+ * \param flags EIB_CACHE_READ_MULTI_FETCH to read ranges containing one group address, which are not cached, from the bus
+ * \param age maximum age of the values in seconds; 0 accepts any age
+ * \param ranges_len length of ranges
+ * \param ranges group address ranges
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Cache_ReadMulti (EIBConnection * con, uint8_t flags, uint16_t age,
+			 int ranges_len, const uint8_t * ranges, int maxlen,
+			 uint8_t * buf);
+
+/** Query the cached values of a list of group address ranges at once - asynchronous.
+ * \param con eibd connection
+ * \param flags EIB_CACHE_READ_MULTI_FETCH to read ranges containing one group address, which are not cached, from the bus
+ * \param age maximum age of the values in seconds; 0 accepts any age
+ * \param ranges_len length of ranges
+ * \param ranges group address ranges
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return 0 if started, -1 if error
+ */
+int EIB_Cache_ReadMulti_async (EIBConnection * con, uint8_t flags,
+			       uint16_t age, int ranges_len,
+			       const uint8_t * ranges, int maxlen,
+			       uint8_t * buf);
+
+/** Query the value history of group addresses, which eibd keeps for the ranges given by --cache-history.
+ * request starts with a time (8 bytes, big endian, microseconds of the eibd clock) followed by the group addresses
+ * (2 bytes each); only values received after this time are returned, 0 returns the whole history.
+ * The answer starts with a flag byte (EIB_CACHE_HISTORY_TRUNCATED) and the current time of the eibd clock (8 bytes),
+ * which can be used as start of the next query. It is followed by one record for each value, oldest first:
+ * group address (2 bytes), source address (2 bytes), receive time (8 bytes), value length (1 byte),
+ * number of stored value bytes (1 byte), stored value bytes. Only the first 14 bytes of longer values are stored.
+ * \param con eibd connection
+ * \param request_len length of request
+ * \param request time and group addresses
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Cache_History (EIBConnection * con, int request_len,
+		       const uint8_t * request, int maxlen, uint8_t * buf);
+
+/** Query the value history of group addresses - asynchronous.
+ * \param con eibd connection
+ * \param request_len length of request
+ * \param request time and group addresses
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return 0 if started, -1 if error
+ */
+int EIB_Cache_History_async (EIBConnection * con, int request_len,
+			     const uint8_t * request, int maxlen,
+			     uint8_t * buf);
+
+/** Start reading all cached values of the group addresses lo to hi, ordered by group address.
+ * A main group m is the range m/0/0 to m/7/255, a middle group m/n the range m/n/0 to m/n/255.
+ * eibd sends the values in parts of up to 4 KiB. Each part starts with a flag byte; all parts
+ * except the last one must be read with EIB_Cache_ScanNext, until EIB_CACHE_SCAN_LAST is set.
+ * The flag byte is followed by one record for each value: group address (2 bytes),
+ * source address (2 bytes), age in seconds (2 bytes), value length (1 byte), value.
+ * \param con eibd connection
+ * \param flags EIB_CACHE_SCAN_SNAPSHOT to get a consistent copy instead of the values at the time each part is sent
+ * \param lo first group address
+ * \param hi last group address
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the first part
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Cache_Scan (EIBConnection * con, uint8_t flags, eibaddr_t lo,
+		    eibaddr_t hi, int maxlen, uint8_t * buf);
+
+/** Start reading all cached values of the group addresses lo to hi - asynchronous.
+ * \param con eibd connection
+ * \param flags EIB_CACHE_SCAN_SNAPSHOT to get a consistent copy
+ * \param lo first group address
+ * \param hi last group address
+ * \param maxlen buffer size
+ * \param buf buffer, which receives the first part
+ * \return 0 if started, -1 if error
+ */
+int EIB_Cache_Scan_async (EIBConnection * con, uint8_t flags, eibaddr_t lo,
+			  eibaddr_t hi, int maxlen, uint8_t * buf);
+
+/** Read the next part of the answer to EIB_Cache_Scan.
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Cache_ScanNext (EIBConnection * con, int maxlen, uint8_t * buf);
+
+/** Read the next part of the answer to EIB_Cache_Scan - asynchronous.
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return 0 if started, -1 if error
+ */
+int EIB_Cache_ScanNext_async (EIBConnection * con, int maxlen,
+			      uint8_t * buf);
+
+/** Read the runtime metrics of eibd.
+ * The report is text with one "name value" pair per line.
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return number of used bytes in the buffer or -1 if error
+ */
+int EIB_Get_Stats (EIBConnection * con, int maxlen, uint8_t * buf);
+
+/** Read the runtime metrics of eibd - asynchronous.
+ * \param con eibd connection
+ * \param maxlen buffer size
+ * \param buf buffer
+ * \return 0 if started, -1 if error
+ */
+int EIB_Get_Stats_async (EIBConnection * con, int maxlen, uint8_t * buf);
+
 
 __END_DECLS
 #endif
@@ -41,6 +41,9 @@
 #define EIB_BUSMONITOR_PACKET_TS        0x0015
 #define EIB_OPEN_BUSMONITOR_TS          0x0016
 #define EIB_OPEN_VBUSMONITOR_TS         0x0017
+#define EIB_DROPPED_PACKETS             0x0018
+#define EIB_OPEN_BUSMONITOR_FORMAT      0x0019
+#define EIB_OPEN_VBUSMONITOR_FORMAT     0x001A
 
 #define EIB_OPEN_T_CONNECTION           0x0020
 #define EIB_OPEN_T_INDIVIDUAL           0x0021
@@ -78,6 +81,7 @@
 #define EIB_MC_PROP_DESC                0x0061
 #define EIB_MC_PROP_SCAN                0x0062
 #define EIB_LOAD_IMAGE                  0x0063
+#define EIB_MC_TAGGED                   0x0064
 
 #define EIB_CACHE_ENABLE                0x0070
 #define EIB_CACHE_DISABLE               0x0071
@@ -86,5 +90,68 @@
 #define EIB_CACHE_READ                  0x0074
 #define EIB_CACHE_READ_NOWAIT           0x0075
 #define EIB_CACHE_LAST_UPDATES          0x0076
+#define EIB_CACHE_CHANGES               0x0077
+#define EIB_OPEN_CACHE_FEED             0x0078
+#define EIB_CACHE_UPDATE                0x0079
+#define EIB_CACHE_READ_MULTI            0x007a
+#define EIB_CACHE_HISTORY               0x007b
+#define EIB_CACHE_SCAN                  0x007c
+
+/* flags of EIB_CACHE_READ_MULTI */
+#define EIB_CACHE_READ_MULTI_FETCH      0x01
+#define EIB_CACHE_READ_MULTI_TRUNCATED  0x01
+/* flags of EIB_CACHE_HISTORY */
+#define EIB_CACHE_HISTORY_TRUNCATED     0x01
+/* flags of EIB_CACHE_SCAN requests */
+#define EIB_CACHE_SCAN_SNAPSHOT         0x01
+/* flags of EIB_CACHE_SCAN answers */
+#define EIB_CACHE_SCAN_LAST             0x01
+
+/* items of the filter of EIB_OPEN_GROUPCON and the busmonitors */
+#define EIB_FILTER_GROUP_RANGE          0x01
+#define EIB_FILTER_GROUP_BITMAP         0x02
+#define EIB_FILTER_SOURCE               0x03
+#define EIB_FILTER_APCI                 0x04
+#define EIB_FILTER_FRAME                0x05
+/* classes of EIB_FILTER_APCI */
+#define EIB_FILTER_APCI_READ            0x01
+#define EIB_FILTER_APCI_RESPONSE        0x02
+#define EIB_FILTER_APCI_WRITE           0x04
+#define EIB_FILTER_APCI_OTHER           0x08
+/* types of EIB_FILTER_FRAME */
+#define EIB_FILTER_FRAME_DATA           0x01
+#define EIB_FILTER_FRAME_ACK            0x02
+#define EIB_FILTER_FRAME_OTHER          0x04
+
+/* formats of EIB_OPEN_BUSMONITOR_FORMAT */
+#define EIB_BUSMONITOR_FORMAT_DECODE    0x00
+#define EIB_BUSMONITOR_FORMAT_TABLE     0x01
+#define EIB_BUSMONITOR_FORMAT_JSON      0x02
+
+#define EIB_GET_STATS                   0x0080
+#define EIB_OPEN_SHM_RING               0x0081
+
+/* layout of the shared memory of EIB_OPEN_SHM_RING: a header of
+ * EIB_SHM_RING_HEADER bytes with the following 32 bit fields, followed
+ * by the data area */
+#define EIB_SHM_RING_HEADER             128
+/* write position, only changed by eibd */
+#define EIB_SHM_RING_HEAD               0
+/* eibd closed the connection */
+#define EIB_SHM_RING_CLOSED             4
+/* read position, only changed by the client */
+#define EIB_SHM_RING_TAIL               64
+/* the client waits for a signal of eibd */
+#define EIB_SHM_RING_WAITING            68
+/* eibd waits for a signal of the client */
+#define EIB_SHM_RING_FULL               72
+/* a record is a 32 bit length in host byte order, followed by the
+ * message, padded to a multiple of 4 bytes */
+/* record length: the next record starts at the beginning of the data area */
+#define EIB_SHM_RING_WRAP               0xffffffff
+/* limits and default of the log2 of the data area size */
+#define EIB_SHM_RING_MIN_ORDER          17
+#define EIB_SHM_RING_MAX_ORDER          26
+#define EIB_SHM_RING_ORDER              20
 
 #endif
@@ -21,157 +21,328 @@
 #include <string.h>
 #include "apdu.h"
 
+/** APCI table entry */
+typedef struct
+{
+  /** APDU type */
+  APDU_type type;
+  /** minimum length of the APDU */
+  unsigned short minlen;
+  /** maximum length of the APDU */
+  unsigned short maxlen;
+} APCI_Entry;
+
+#define APCI(type, min, max) { type, min, max }
+#define APCI_NONE { A_Unknown, 0, 0 }
+#define APCI_NOLIMIT 0xffff
+
+/* APDU types indexed by the upper 4 bits of the APCI; the entries for
+ * 0x2C0 and 0x3C0 are refined by the tables of the extended APCIs */
+static const APCI_Entry apci_main[16] = {
+  /* 000 */ APCI (A_GroupValue_Read, 2, 2),
+  /* 040 */ APCI (A_GroupValue_Response, 2, APCI_NOLIMIT),
+  /* 080 */ APCI (A_GroupValue_Write, 2, APCI_NOLIMIT),
+  /* 0C0 */ APCI (A_IndividualAddress_Write, 4, 4),
+  /* 100 */ APCI (A_IndividualAddress_Read, 2, 2),
+  /* 140 */ APCI (A_IndividualAddress_Response, 2, 2),
+  /* 180 */ APCI (A_ADC_Read, 3, 3),
+  /* 1C0 */ APCI (A_ADC_Response, 5, 5),
+  /* 200 */ APCI (A_Memory_Read, 4, 4),
+  /* 240 */ APCI (A_Memory_Response, 4, APCI_NOLIMIT),
+  /* 280 */ APCI (A_Memory_Write, 4, APCI_NOLIMIT),
+  /* 2C0 */ APCI_NONE,
+  /* 300 */ APCI (A_DeviceDescriptor_Read, 2, 2),
+  /* 340 */ APCI (A_DeviceDescriptor_Response, 4, 4),
+  /* 380 */ APCI (A_Restart, 2, 2),
+  /* 3C0 */ APCI_NONE,
+};
+
+/* extended APCIs 0x2C0-0x2FF */
+static const APCI_Entry apci_user[64] = {
+  /* 2C0 */ APCI (A_UserMemory_Read, 5, 5),
+  /* 2C1 */ APCI (A_UserMemory_Response, 5, APCI_NOLIMIT),
+  /* 2C2 */ APCI (A_UserMemory_Write, 5, APCI_NOLIMIT),
+  /* 2C3 */ APCI_NONE,
+  /* 2C4 */ APCI (A_UserMemoryBit_Write, 5, APCI_NOLIMIT),
+  /* 2C5 */ APCI (A_UserManufacturerInfo_Read, 2, 2),
+  /* 2C6 */ APCI (A_UserManufacturerInfo_Response, 5, 5),
+  /* 2C7 */ APCI_NONE,
+  /* 2C8 */ APCI_NONE,
+  /* 2C9 */ APCI_NONE,
+  /* 2CA */ APCI_NONE,
+  /* 2CB */ APCI_NONE,
+  /* 2CC */ APCI_NONE,
+  /* 2CD */ APCI_NONE,
+  /* 2CE */ APCI_NONE,
+  /* 2CF */ APCI_NONE,
+  /* 2D0 */ APCI_NONE,
+  /* 2D1 */ APCI_NONE,
+  /* 2D2 */ APCI_NONE,
+  /* 2D3 */ APCI_NONE,
+  /* 2D4 */ APCI_NONE,
+  /* 2D5 */ APCI_NONE,
+  /* 2D6 */ APCI_NONE,
+  /* 2D7 */ APCI_NONE,
+  /* 2D8 */ APCI_NONE,
+  /* 2D9 */ APCI_NONE,
+  /* 2DA */ APCI_NONE,
+  /* 2DB */ APCI_NONE,
+  /* 2DC */ APCI_NONE,
+  /* 2DD */ APCI_NONE,
+  /* 2DE */ APCI_NONE,
+  /* 2DF */ APCI_NONE,
+  /* 2E0 */ APCI_NONE,
+  /* 2E1 */ APCI_NONE,
+  /* 2E2 */ APCI_NONE,
+  /* 2E3 */ APCI_NONE,
+  /* 2E4 */ APCI_NONE,
+  /* 2E5 */ APCI_NONE,
+  /* 2E6 */ APCI_NONE,
+  /* 2E7 */ APCI_NONE,
+  /* 2E8 */ APCI_NONE,
+  /* 2E9 */ APCI_NONE,
+  /* 2EA */ APCI_NONE,
+  /* 2EB */ APCI_NONE,
+  /* 2EC */ APCI_NONE,
+  /* 2ED */ APCI_NONE,
+  /* 2EE */ APCI_NONE,
+  /* 2EF */ APCI_NONE,
+  /* 2F0 */ APCI_NONE,
+  /* 2F1 */ APCI_NONE,
+  /* 2F2 */ APCI_NONE,
+  /* 2F3 */ APCI_NONE,
+  /* 2F4 */ APCI_NONE,
+  /* 2F5 */ APCI_NONE,
+  /* 2F6 */ APCI_NONE,
+  /* 2F7 */ APCI_NONE,
+  /* 2F8 */ APCI_NONE,
+  /* 2F9 */ APCI_NONE,
+  /* 2FA */ APCI_NONE,
+  /* 2FB */ APCI_NONE,
+  /* 2FC */ APCI_NONE,
+  /* 2FD */ APCI_NONE,
+  /* 2FE */ APCI_NONE,
+  /* 2FF */ APCI_NONE,
+};
+
+/* extended APCIs 0x3C0-0x3FF */
+static const APCI_Entry apci_ext[64] = {
+  /* 3C0 */ APCI_NONE,
+  /* 3C1 */ APCI_NONE,
+  /* 3C2 */ APCI_NONE,
+  /* 3C3 */ APCI_NONE,
+  /* 3C4 */ APCI_NONE,
+  /* 3C5 */ APCI_NONE,
+  /* 3C6 */ APCI_NONE,
+  /* 3C7 */ APCI_NONE,
+  /* 3C8 */ APCI_NONE,
+  /* 3C9 */ APCI_NONE,
+  /* 3CA */ APCI_NONE,
+  /* 3CB */ APCI_NONE,
+  /* 3CC */ APCI_NONE,
+  /* 3CD */ APCI_NONE,
+  /* 3CE */ APCI_NONE,
+  /* 3CF */ APCI_NONE,
+  /* 3D0 */ APCI (A_MemoryBit_Write, 5, APCI_NOLIMIT),
+  /* 3D1 */ APCI (A_Authorize_Request, 7, 7),
+  /* 3D2 */ APCI (A_Authorize_Response, 3, 3),
+  /* 3D3 */ APCI (A_Key_Write, 7, 7),
+  /* 3D4 */ APCI (A_Key_Response, 3, 3),
+  /* 3D5 */ APCI (A_PropertyValue_Read, 6, 6),
+  /* 3D6 */ APCI (A_PropertyValue_Response, 6, APCI_NOLIMIT),
+  /* 3D7 */ APCI (A_PropertyValue_Write, 6, APCI_NOLIMIT),
+  /* 3D8 */ APCI (A_PropertyDescription_Read, 5, 5),
+  /* 3D9 */ APCI (A_PropertyDescription_Response, 9, 9),
+  /* 3DA */ APCI_NONE,
+  /* 3DB */ APCI_NONE,
+  /* 3DC */ APCI (A_IndividualAddressSerialNumber_Read, 8, 8),
+  /* 3DD */ APCI (A_IndividualAddressSerialNumber_Response, 12, 12),
+  /* 3DE */ APCI (A_IndividualAddressSerialNumber_Write, 14, 14),
+  /* 3DF */ APCI (A_ServiceInformation_Indication_Write, 5, 5),
+  /* 3E0 */ APCI (A_DomainAddress_Write, 4, 4),
+  /* 3E1 */ APCI (A_DomainAddress_Read, 2, 2),
+  /* 3E2 */ APCI (A_DomainAddress_Response, 4, 4),
+  /* 3E3 */ APCI (A_DomainAddressSelective_Read, 7, 7),
+  /* 3E4 */ APCI_NONE,
+  /* 3E5 */ APCI_NONE,
+  /* 3E6 */ APCI_NONE,
+  /* 3E7 */ APCI_NONE,
+  /* 3E8 */ APCI_NONE,
+  /* 3E9 */ APCI_NONE,
+  /* 3EA */ APCI_NONE,
+  /* 3EB */ APCI_NONE,
+  /* 3EC */ APCI_NONE,
+  /* 3ED */ APCI_NONE,
+  /* 3EE */ APCI_NONE,
+  /* 3EF */ APCI_NONE,
+  /* 3F0 */ APCI_NONE,
+  /* 3F1 */ APCI_NONE,
+  /* 3F2 */ APCI_NONE,
+  /* 3F3 */ APCI_NONE,
+  /* 3F4 */ APCI_NONE,
+  /* 3F5 */ APCI_NONE,
+  /* 3F6 */ APCI_NONE,
+  /* 3F7 */ APCI_NONE,
+  /* 3F8 */ APCI_NONE,
+  /* 3F9 */ APCI_NONE,
+  /* 3FA */ APCI_NONE,
+  /* 3FB */ APCI_NONE,
+  /* 3FC */ APCI_NONE,
+  /* 3FD */ APCI_NONE,
+  /* 3FE */ APCI_NONE,
+  /* 3FF */ APCI_NONE,
+};
+
+bool
+APDU_View::init (const uchar * c, unsigned l)
+{
+  const APCI_Entry *e;
+  type = A_Unknown;
+  data = 0;
+  len = 0;
+  small = 0;
+  if (l < 2)
+    return false;
+  unsigned apci = ((c[0] & 0x03) << 2) | (c[1] >> 6);
+  if (apci == 0x0B)
+    e = &apci_user[c[1] & 0x3f];
+  else if (apci == 0x0F)
+    e = &apci_ext[c[1] & 0x3f];
+  else
+    e = &apci_main[apci];
+  if (e->type == A_Unknown || l < e->minlen || l > e->maxlen)
+    return false;
+  type = e->type;
+  small = c[1] & 0x3f;
+  data = c + 2;
+  len = l - 2;
+  return true;
+}
+
 APDU *
 APDU::fromPacket (const CArray & c)
 {
   APDU *a = 0;
-  if (c () >= 2)
+  APDU_View v;
+  v.init (c);
+  switch (v.type)
     {
-      switch (c[0] & 0x03)
-	{
-	case 0:
-	  switch (c[1] & 0xC0)
-	    {
-	    case 0x00:
-	      a = new A_GroupValue_Read_PDU ();
-	      break;
-	    case 0x40:
-	      a = new A_GroupValue_Response_PDU ();
-	      break;
-	    case 0x80:
-	      a = new A_GroupValue_Write_PDU ();
-	      break;
-	    case 0xC0:
-	      a = new A_IndividualAddress_Write_PDU ();
-	      break;
-	    }
-	  break;
-	case 1:
-	  switch (c[1] & 0xC0)
-	    {
-	    case 0x00:
-	      a = new A_IndividualAddress_Read_PDU ();
-	      break;
-	    case 0x40:
-	      a = new A_IndividualAddress_Response_PDU ();
-	      break;
-	    case 0x80:
-	      a = new A_ADC_Read_PDU ();
-	      break;
-	    case 0xC0:
-	      a = new A_ADC_Response_PDU ();
-	      break;
-	    }
-	  break;
-	case 2:
-	  switch (c[1] & 0xC0)
-	    {
-	    case 0x00:
-	      a = new A_Memory_Read_PDU ();
-	      break;
-	    case 0x40:
-	      a = new A_Memory_Response_PDU ();
-	      break;
-	    case 0x80:
-	      a = new A_Memory_Write_PDU ();
-	      break;
-	    case 0xC0:
-	      switch (c[1])
-		{
-		case 0xC0:
-		  a = new A_UserMemory_Read_PDU ();
-		  break;
-		case 0xC1:
-		  a = new A_UserMemory_Response_PDU ();
-		  break;
-		case 0xC2:
-		  a = new A_UserMemory_Write_PDU ();
-		  break;
-		case 0xC4:
-		  a = new A_UserMemoryBit_Write_PDU ();
-		  break;
-		case 0xC5:
-		  a = new A_UserManufacturerInfo_Read_PDU ();
-		  break;
-		case 0xC6:
-		  a = new A_UserManufacturerInfo_Response_PDU ();
-		  break;
-		}
-	    }
-	  break;
-	case 3:
-	  switch (c[1] & 0xC0)
-	    {
-	    case 0x00:
-	      a = new A_DeviceDescriptor_Read_PDU ();
-	      break;
-	    case 0x40:
-	      a = new A_DeviceDescriptor_Response_PDU ();
-	      break;
-	    case 0x80:
-	      a = new A_Restart_PDU ();
-	      break;
-	    case 0xC0:
-	      switch (c[1])
-		{
-		case 0xD0:
-		  a = new A_MemoryBit_Write_PDU ();
-		  break;
-		case 0xD1:
-		  a = new A_Authorize_Request_PDU ();
-		  break;
-		case 0xD2:
-		  a = new A_Authorize_Response_PDU ();
-		  break;
-		case 0xD3:
-		  a = new A_Key_Write_PDU ();
-		  break;
-		case 0xD4:
-		  a = new A_Key_Response_PDU ();
-		  break;
-		case 0xD5:
-		  a = new A_PropertyValue_Read_PDU ();
-		  break;
-		case 0xD6:
-		  a = new A_PropertyValue_Response_PDU ();
-		  break;
-		case 0xD7:
-		  a = new A_PropertyValue_Write_PDU ();
-		  break;
-		case 0xD8:
-		  a = new A_PropertyDescription_Read_PDU ();
-		  break;
-		case 0xD9:
-		  a = new A_PropertyDescription_Response_PDU ();
-		  break;
-		case 0xDC:
-		  a = new A_IndividualAddressSerialNumber_Read_PDU ();
-		  break;
-		case 0xDD:
-		  a = new A_IndividualAddressSerialNumber_Response_PDU ();
-		  break;
-		case 0xDE:
-		  a = new A_IndividualAddressSerialNumber_Write_PDU ();
-		  break;
-		case 0xDF:
-		  a = new A_ServiceInformation_Indication_Write_PDU ();
-		  break;
-		case 0xE0:
-		  a = new A_DomainAddress_Write_PDU ();
-		  break;
-		case 0xE1:
-		  a = new A_DomainAddress_Read_PDU ();
-		  break;
-		case 0xE2:
-		  a = new A_DomainAddress_Response_PDU ();
-		  break;
-		case 0xE3:
-		  a = new A_DomainAddressSelective_Read_PDU ();
-		  break;
-		}
-	    }
-	  break;
-	}
+    case A_GroupValue_Read:
+      a = new A_GroupValue_Read_PDU ();
+      break;
+    case A_GroupValue_Response:
+      a = new A_GroupValue_Response_PDU ();
+      break;
+    case A_GroupValue_Write:
+      a = new A_GroupValue_Write_PDU ();
+      break;
+    case A_IndividualAddress_Write:
+      a = new A_IndividualAddress_Write_PDU ();
+      break;
+    case A_IndividualAddress_Read:
+      a = new A_IndividualAddress_Read_PDU ();
+      break;
+    case A_IndividualAddress_Response:
+      a = new A_IndividualAddress_Response_PDU ();
+      break;
+    case A_ADC_Read:
+      a = new A_ADC_Read_PDU ();
+      break;
+    case A_ADC_Response:
+      a = new A_ADC_Response_PDU ();
+      break;
+    case A_Memory_Read:
+      a = new A_Memory_Read_PDU ();
+      break;
+    case A_Memory_Response:
+      a = new A_Memory_Response_PDU ();
+      break;
+    case A_Memory_Write:
+      a = new A_Memory_Write_PDU ();
+      break;
+    case A_UserMemory_Read:
+      a = new A_UserMemory_Read_PDU ();
+      break;
+    case A_UserMemory_Response:
+      a = new A_UserMemory_Response_PDU ();
+      break;
+    case A_UserMemory_Write:
+      a = new A_UserMemory_Write_PDU ();
+      break;
+    case A_UserMemoryBit_Write:
+      a = new A_UserMemoryBit_Write_PDU ();
+      break;
+    case A_UserManufacturerInfo_Read:
+      a = new A_UserManufacturerInfo_Read_PDU ();
+      break;
+    case A_UserManufacturerInfo_Response:
+      a = new A_UserManufacturerInfo_Response_PDU ();
+      break;
+    case A_DeviceDescriptor_Read:
+      a = new A_DeviceDescriptor_Read_PDU ();
+      break;
+    case A_DeviceDescriptor_Response:
+      a = new A_DeviceDescriptor_Response_PDU ();
+      break;
+    case A_Restart:
+      a = new A_Restart_PDU ();
+      break;
+    case A_MemoryBit_Write:
+      a = new A_MemoryBit_Write_PDU ();
+      break;
+    case A_Authorize_Request:
+      a = new A_Authorize_Request_PDU ();
+      break;
+    case A_Authorize_Response:
+      a = new A_Authorize_Response_PDU ();
+      break;
+    case A_Key_Write:
+      a = new A_Key_Write_PDU ();
+      break;
+    case A_Key_Response:
+      a = new A_Key_Response_PDU ();
+      break;
+    case A_PropertyValue_Read:
+      a = new A_PropertyValue_Read_PDU ();
+      break;
+    case A_PropertyValue_Response:
+      a = new A_PropertyValue_Response_PDU ();
+      break;
+    case A_PropertyValue_Write:
+      a = new A_PropertyValue_Write_PDU ();
+      break;
+    case A_PropertyDescription_Read:
+      a = new A_PropertyDescription_Read_PDU ();
+      break;
+    case A_PropertyDescription_Response:
+      a = new A_PropertyDescription_Response_PDU ();
+      break;
+    case A_IndividualAddressSerialNumber_Read:
+      a = new A_IndividualAddressSerialNumber_Read_PDU ();
+      break;
+    case A_IndividualAddressSerialNumber_Response:
+      a = new A_IndividualAddressSerialNumber_Response_PDU ();
+      break;
+    case A_IndividualAddressSerialNumber_Write:
+      a = new A_IndividualAddressSerialNumber_Write_PDU ();
+      break;
+    case A_ServiceInformation_Indication_Write:
+      a = new A_ServiceInformation_Indication_Write_PDU ();
+      break;
+    case A_DomainAddress_Write:
+      a = new A_DomainAddress_Write_PDU ();
+      break;
+    case A_DomainAddress_Read:
+      a = new A_DomainAddress_Read_PDU ();
+      break;
+    case A_DomainAddress_Response:
+      a = new A_DomainAddress_Response_PDU ();
+      break;
+    case A_DomainAddressSelective_Read:
+      a = new A_DomainAddressSelective_Read_PDU ();
+      break;
+    case A_Unknown:
+      break;
     }
   if (a && a->init (c))
     return a;
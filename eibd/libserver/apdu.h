@@ -68,7 +68,34 @@ typedef enum
 }
 APDU_type;
 
-/** represents a TPDU */
+/** decoded APDU, which refers to the decoded packet instead of
+ * copying it; it needs no allocation and is valid as long as the packet
+ *
+ * Only the APCI and the length are checked, the type specific fields
+ * are left to the user.
+ */
+class APDU_View
+{
+public:
+  /** APDU type, A_Unknown if APCI or length are invalid */
+  APDU_type type;
+  /** lower 6 bits of the second octet (e.g. small group value) */
+  uchar small;
+  /** octets following the APCI */
+  const uchar *data;
+  /** number of octets following the APCI */
+  unsigned len;
+
+  /** decodes the APDU c of length l, returns false for A_Unknown */
+  bool init (const uchar * c, unsigned l);
+  /** decodes the APDU c, returns false for A_Unknown */
+  bool init (const CArray & c)
+  {
+    return init (c.array (), c ());
+  }
+};
+
+/** represents a APDU */
 class APDU
 {
 public:
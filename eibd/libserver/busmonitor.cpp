@@ -29,12 +29,12 @@ A_Busmonitor::~A_Busmonitor ()
     l3->deregisterBusmonitor (this);
   while (!data.isempty ())
     {
-      delete data.get ();
+      data.get ()->unref ();
     }
 }
 
 A_Busmonitor::A_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr,
-			    bool virt, bool TS)
+			    bool virt, bool TS, unsigned hdr)
 {
   TRACEPRINTF (tr, 7, this, "Open A_Busmonitor");
   this->l3 = l3;
@@ -42,6 +42,8 @@ A_Busmonitor::A_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr,
   con = c;
   v = virt;
   ts = TS;
+  filter_ok = c->size < hdr || filter.init (c->buf + hdr, c->size - hdr);
+  data.setLimit (l3->queuelimit);
   pth_sem_init (&sem);
   Start ();
 }
@@ -49,19 +51,43 @@ A_Busmonitor::A_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr,
 void
 A_Busmonitor::Get_L_Busmonitor (L_Busmonitor_PDU * l)
 {
-  data.put (l);
-  pth_sem_inc (&sem, 0);
+  if (!data.full ())
+    {
+      data.put (l);
+      pth_sem_inc (&sem, 0);
+      return;
+    }
+  clientdropped.inc ();
+  if (data.overflow ())
+    {
+      data.get ()->unref ();
+      data.put (l);
+    }
+  else
+    l->unref ();
+  TRACEPRINTF (t, 7, this, "Busmonitor queue full, %lu dropped",
+	       data.dropped);
+  if (data.disconnect)
+    con->disconnect ();
 }
 
 void
 A_Busmonitor::Run (pth_sem_t * stop1)
 {
   CArray resp;
+  unsigned long dropped = 0;
 
   pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  const FrameFilter *f = filter.empty ()? 0 : &filter;
+  if (!filter_ok)
+    {
+      con->sendreject (stop, EIB_PROCESSING_ERROR);
+      pth_event_free (stop, PTH_FREE_THIS);
+      return;
+    }
   if (v)
     {
-      if (!l3->registerVBusmonitor (this))
+      if (!l3->registerVBusmonitor (this, f))
 	{
 	  con->sendreject (stop, EIB_CONNECTION_INUSE);
 	  return;
@@ -69,7 +95,7 @@ A_Busmonitor::Run (pth_sem_t * stop1)
     }
   else
     {
-      if (!l3->registerBusmonitor (this))
+      if (!l3->registerBusmonitor (this, f))
 	{
 	  con->sendreject (stop, EIB_CONNECTION_INUSE);
 	  return;
@@ -97,12 +123,27 @@ A_Busmonitor::Run (pth_sem_t * stop1)
 
       if (pth_event_status (sem_ev) == PTH_STATUS_OCCURRED)
 	{
-	  pth_sem_dec (&sem);
-	  TRACEPRINTF (t, 7, this, "Send Busmonitor-Packet");
-	  if (sendResponse (data.get (), stop) == -1)
+	  /* send all pending frames with one write */
+	  startBatch ();
+	  do
+	    {
+	      pth_sem_dec (&sem);
+	      if (data.dropped != dropped)
+		{
+		  dropped = data.dropped;
+		  if (con->senddropped (dropped, stop) == -1)
+		    goto out;
+		}
+	      TRACEPRINTF (t, 7, this, "Send Busmonitor-Packet");
+	      if (queueResponse (data.get (), stop) == -1)
+		goto out;
+	    }
+	  while (!data.isempty ());
+	  if (con->flush (stop) == -1)
 	    break;
 	}
     }
+out:
   pth_event_free (sem_ev, PTH_FREE_THIS);
   pth_event_free (stop, PTH_FREE_THIS);
 }
@@ -121,18 +162,20 @@ A_Busmonitor::Do (pth_event_t stop)
 }
 
 int
-A_Busmonitor::sendResponse (L_Busmonitor_PDU * p, pth_event_t stop)
+A_Busmonitor::queueResponse (L_Busmonitor_PDU * p, pth_event_t stop)
 {
   CArray buf;
   if (ts)
     {
+      /* all backends stamp the frames with the same clock */
+      uint32_t stamp = p->arrival ? p->arrival / 1000 : p->timestamp;
       buf.resize (7 + p->pdu ());
       EIBSETTYPE (buf, EIB_BUSMONITOR_PACKET_TS);
       buf[2] = p->status;
-      buf[3] = (p->timestamp >> 24) & 0xff;
-      buf[4] = (p->timestamp >> 16) & 0xff;
-      buf[5] = (p->timestamp >> 8) & 0xff;
-      buf[6] = (p->timestamp) & 0xff;
+      buf[3] = (stamp >> 24) & 0xff;
+      buf[4] = (stamp >> 16) & 0xff;
+      buf[5] = (stamp >> 8) & 0xff;
+      buf[6] = (stamp) & 0xff;
       buf.setpart (p->pdu.array (), 7, p->pdu ());
     }
   else
@@ -141,21 +184,315 @@ A_Busmonitor::sendResponse (L_Busmonitor_PDU * p, pth_event_t stop)
       EIBSETTYPE (buf, EIB_BUSMONITOR_PACKET);
       buf.setpart (p->pdu.array (), 2, p->pdu ());
     }
-  delete p;
+  p->unref ();
 
-  return con->sendmessage (buf (), buf.array (), stop);
+  return con->queuemessage (buf (), buf.array (), stop);
+}
+
+/** hex digits of the preformatted busmonitor formats */
+static const char hexdigits[] = "0123456789ABCDEF";
+
+/** busmonitor frame, parsed in place */
+struct MonitorFrame
+{
+  /** frame type */
+  const char *type;
+  /** is a data frame with complete header */
+  bool data;
+  const char *prio;
+  bool repeated;
+  eibaddr_t src;
+  eibaddr_t dst;
+  bool group;
+  uchar hops;
+  /** group service, 0 for all other TPDUs */
+  const char *service;
+};
+
+/** parses the header fields of a TP1 frame */
+static void
+parseFrame (const CArray & c, MonitorFrame & f)
+{
+  static const char *const prios[4] = { "system", "urgent", "normal", "low" };
+  const uchar *tpdu;
+  unsigned tlen;
+
+  f.data = false;
+  f.service = 0;
+  if (c () == 1 && c[0] == 0xCC)
+    f.type = "ack";
+  else if (c () == 1 && c[0] == 0x0C)
+    f.type = "nack";
+  else if (c () == 1 && c[0] == 0xC0)
+    f.type = "busy";
+  else if (c () >= 1 && (c[0] & 0x53) == 0x10)
+    f.type = "data";
+  else
+    f.type = "other";
+  if (f.type[0] != 'd')
+    return;
+
+  if (c[0] & 0x80)
+    {
+      /* standard frame */
+      if (c () < 7)
+	return;
+      f.src = (c[1] << 8) | c[2];
+      f.dst = (c[3] << 8) | c[4];
+      f.group = c[5] & 0x80;
+      f.hops = (c[5] >> 4) & 0x07;
+      tpdu = c.array () + 6;
+      tlen = c () - 7;
+    }
+  else
+    {
+      /* extended frame */
+      if (c () < 8)
+	return;
+      f.group = c[1] & 0x80;
+      f.hops = (c[1] >> 4) & 0x07;
+      f.src = (c[2] << 8) | c[3];
+      f.dst = (c[4] << 8) | c[5];
+      tpdu = c.array () + 7;
+      tlen = c () - 8;
+    }
+  f.data = true;
+  f.prio = prios[(c[0] >> 2) & 0x03];
+  f.repeated = !(c[0] & 0x20);
+  if (f.group && tlen >= 2 && (tpdu[0] & 0xfc) == 0)
+    switch (((tpdu[0] & 0x03) << 8 | tpdu[1]) & 0x3c0)
+      {
+      case 0x000:
+	f.service = "read";
+	break;
+      case 0x040:
+	f.service = "response";
+	break;
+      case 0x080:
+	f.service = "write";
+	break;
+      }
+}
+
+/** appends a string */
+static uchar *
+putString (uchar * d, const char *s)
+{
+  while (*s)
+    *d++ = *s++;
+  return d;
+}
+
+/** appends v in decimal */
+static uchar *
+putDec (uchar * d, unsigned v)
+{
+  uchar tmp[10];
+  int i = 0;
+  do
+    {
+      tmp[i++] = '0' + v % 10;
+      v /= 10;
+    }
+  while (v);
+  while (i)
+    *d++ = tmp[--i];
+  return d;
+}
+
+/** appends v in decimal with exactly width digits */
+static uchar *
+putDecFixed (uchar * d, unsigned v, int width)
+{
+  for (int i = width - 1; i >= 0; i--)
+    {
+      d[i] = '0' + v % 10;
+      v /= 10;
+    }
+  return d + width;
+}
+
+/** fills the field starting at start with blanks up to width */
+static uchar *
+pad (uchar * start, uchar * d, unsigned width)
+{
+  while (d < start + width)
+    *d++ = ' ';
+  return d;
+}
+
+/** appends an individual or group address */
+static uchar *
+putAddr (uchar * d, eibaddr_t a, bool group)
+{
+  if (group)
+    {
+      d = putDec (d, (a >> 11) & 0x1f);
+      *d++ = '/';
+      d = putDec (d, (a >> 8) & 0x07);
+      *d++ = '/';
+    }
+  else
+    {
+      d = putDec (d, (a >> 12) & 0x0f);
+      *d++ = '.';
+      d = putDec (d, (a >> 8) & 0x0f);
+      *d++ = '.';
+    }
+  return putDec (d, a & 0xff);
+}
+
+/** appends the system time of the arrival as seconds with microseconds
+ * @param offset offset of the system clock to the monotonic clock in ns
+ */
+static uchar *
+putTime (uchar * d, timestamp_t arrival, timestamp_t offset)
+{
+  timestamp_t t = (arrival ? arrival : getMonotonicTime ()) + offset;
+  d = putDec (d, t / 1000000000);
+  *d++ = '.';
+  return putDecFixed (d, (t / 1000) % 1000000, 6);
+}
+
+Text_Busmonitor_Formatter::Text_Busmonitor_Formatter ()
+{
+  updateClock ();
+}
+
+void
+Text_Busmonitor_Formatter::updateClock ()
+{
+  clockoffset = getTime () * 1000 - getMonotonicTime ();
+}
+
+unsigned
+Text_Busmonitor_Formatter::formatTable (const L_Busmonitor_PDU * p)
+{
+  const CArray & c = p->pdu;
+  unsigned len = c () > TEXT_BUSMONITOR_MAXFRAME ?
+    TEXT_BUSMONITOR_MAXFRAME : c ();
+  uchar *d = line + 2, *f;
+  MonitorFrame fr;
+
+  parseFrame (c, fr);
+  EIBSETTYPE (line, EIB_BUSMONITOR_PACKET);
+
+  /* time, right aligned to 17 columns */
+  f = d;
+  d = putTime (d, p->arrival, clockoffset);
+  if (d < f + 17)
+    {
+      memmove (f + 17 - (d - f), f, d - f);
+      memset (f, ' ', 17 - (d - f));
+      d = f + 17;
+    }
+  *d++ = ' ';
+  f = d;
+  d = pad (f, putString (d, fr.type), 5);
+  *d++ = ' ';
+  if (fr.data)
+    {
+      f = d;
+      d = pad (f, putString (d, fr.prio), 6);
+      *d++ = ' ';
+      *d++ = fr.repeated ? 'R' : '-';
+      *d++ = ' ';
+      f = d;
+      d = pad (f, putAddr (d, fr.src, false), 9);
+      *d++ = ' ';
+      f = d;
+      d = pad (f, putAddr (d, fr.dst, fr.group), 9);
+      *d++ = ' ';
+      *d++ = '0' + fr.hops;
+      *d++ = ' ';
+      f = d;
+      d = pad (f, putString (d, fr.service ? fr.service : "-"), 8);
+    }
+  else
+    d = putString (d, "-      - -         -         - -       ");
+
+  for (unsigned i = 0; i < len; i++)
+    {
+      *d++ = ' ';
+      *d++ = hexdigits[c[i] >> 4];
+      *d++ = hexdigits[c[i] & 0x0f];
+    }
+  *d++ = 0;
+  return d - line;
+}
+
+unsigned
+Text_Busmonitor_Formatter::formatJSON (const L_Busmonitor_PDU * p)
+{
+  const CArray & c = p->pdu;
+  unsigned len = c () > TEXT_BUSMONITOR_MAXFRAME ?
+    TEXT_BUSMONITOR_MAXFRAME : c ();
+  uchar *d = line + 2;
+  MonitorFrame fr;
+
+  parseFrame (c, fr);
+  EIBSETTYPE (line, EIB_BUSMONITOR_PACKET);
+
+  d = putString (d, "{\"time\":");
+  d = putTime (d, p->arrival, clockoffset);
+  d = putString (d, ",\"type\":\"");
+  d = putString (d, fr.type);
+  if (fr.data)
+    {
+      d = putString (d, "\",\"prio\":\"");
+      d = putString (d, fr.prio);
+      d = putString (d, fr.repeated ? "\",\"repeated\":true,\"src\":\"" :
+		     "\",\"repeated\":false,\"src\":\"");
+      d = putAddr (d, fr.src, false);
+      d = putString (d, "\",\"dst\":\"");
+      d = putAddr (d, fr.dst, fr.group);
+      d = putString (d, fr.group ? "\",\"group\":true,\"hops\":" :
+		     "\",\"group\":false,\"hops\":");
+      *d++ = '0' + fr.hops;
+      if (fr.service)
+	{
+	  d = putString (d, ",\"service\":\"");
+	  d = putString (d, fr.service);
+	  *d++ = '"';
+	}
+      d = putString (d, ",\"frame\":\"");
+    }
+  else
+    d = putString (d, "\",\"frame\":\"");
+
+  for (unsigned i = 0; i < len; i++)
+    {
+      *d++ = hexdigits[c[i] >> 4];
+      *d++ = hexdigits[c[i] & 0x0f];
+    }
+  *d++ = '"';
+  *d++ = '}';
+  *d++ = 0;
+  return d - line;
 }
 
 int
-A_Text_Busmonitor::sendResponse (L_Busmonitor_PDU * p, pth_event_t stop)
+A_Text_Busmonitor::queueResponse (L_Busmonitor_PDU * p, pth_event_t stop)
 {
-  CArray buf;
-  String s = p->Decode ();
-  buf.resize (2 + strlen (s ()) + 1);
-  EIBSETTYPE (buf, EIB_BUSMONITOR_PACKET);
-  buf.setpart ((const uchar *) s (), 2, strlen (s ()));
-  buf[buf () - 1] = 0;
-  delete p;
-
-  return con->sendmessage (buf (), buf.array (), stop);
+  unsigned len;
+
+  if (format == EIB_BUSMONITOR_FORMAT_TABLE)
+    len = formatter.formatTable (p);
+  else if (format == EIB_BUSMONITOR_FORMAT_JSON)
+    len = formatter.formatJSON (p);
+  else
+    {
+      CArray buf;
+      String s = p->Decode ();
+      buf.resize (2 + strlen (s ()) + 1);
+      EIBSETTYPE (buf, EIB_BUSMONITOR_PACKET);
+      buf.setpart ((const uchar *) s (), 2, strlen (s ()));
+      buf[buf () - 1] = 0;
+      p->unref ();
+
+      return con->queuemessage (buf (), buf.array (), stop);
+    }
+  p->unref ();
+
+  return con->queuemessage (len, formatter.message (), stop);
 }
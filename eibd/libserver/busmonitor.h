@@ -29,11 +29,15 @@ class A_Busmonitor:public L_Busmonitor_CallBack, private Thread
   /** semaphore for the input queue */
   pth_sem_t sem;
   /** input queue */
-    Queue < L_Busmonitor_PDU * >data;
+    BoundedQueue < L_Busmonitor_PDU * >data;
     /** is virtual busmonitor */
   bool v;
     /** should provide timestamps */
   bool ts;
+  /** frames, which should be delivered */
+  FrameFilter filter;
+  /** filter of the open request is valid */
+  bool filter_ok;
 
   void Run (pth_sem_t * stop);
 protected:
@@ -43,8 +47,12 @@ protected:
   ClientConnection *con;
   /** debug output */
   Trace *t;
-  /** turns a busmonitor LPDU into a eibd packet and sends it */
-  virtual int sendResponse (L_Busmonitor_PDU * p, pth_event_t stop);
+  /** turns a busmonitor LPDU into a eibd packet and queues it */
+  virtual int queueResponse (L_Busmonitor_PDU * p, pth_event_t stop);
+  /** called before the pending frames are queued with one write */
+  virtual void startBatch ()
+  {
+  }
 public:
   /** initializes busmonitor
    * @param c client connection
@@ -52,9 +60,10 @@ public:
    * @param l3 Layer 3
    * @param virt is virtual busmonitor
    * @param ts provide timestamps
+   * @param hdr length of the open request before the filter
    */
     A_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr, bool virt =
-		  false, bool ts = false);
+		  false, bool ts = false, unsigned hdr = 2);
     virtual ~ A_Busmonitor ();
   void Get_L_Busmonitor (L_Busmonitor_PDU * l);
 
@@ -62,22 +71,65 @@ public:
   void Do (pth_event_t stop);
 };
 
+/** maximum number of frame bytes shown by a preformatted text busmonitor */
+#define TEXT_BUSMONITOR_MAXFRAME 263
+/** size of the line buffer of a text busmonitor */
+#define TEXT_BUSMONITOR_LINE (2 + 200 + 3 * TEXT_BUSMONITOR_MAXFRAME)
+
+/** formats busmonitor frames as eibd packets of the preformatted
+ * text formats */
+class Text_Busmonitor_Formatter
+{
+  /** message buffer, reused for all frames */
+  uchar line[TEXT_BUSMONITOR_LINE];
+  /** offset of the system clock to the monotonic clock in ns */
+  timestamp_t clockoffset;
+public:
+    Text_Busmonitor_Formatter ();
+
+  /** reads the offset between the system and the monotonic clock,
+   * which is used for the times of the following frames */
+  void updateClock ();
+  /** formats p as table row
+   * @return message length */
+  unsigned formatTable (const L_Busmonitor_PDU * p);
+  /** formats p as JSON object
+   * @return message length */
+  unsigned formatJSON (const L_Busmonitor_PDU * p);
+  /** returns the message formatted last */
+  const uchar *message () const
+  {
+    return line;
+  }
+};
+
 /** implements text busmonitor functions for a client */
 class A_Text_Busmonitor:public A_Busmonitor
 {
+  /** output format (EIB_BUSMONITOR_FORMAT_*) */
+  uchar format;
+  /** formatter of the preformatted formats */
+  Text_Busmonitor_Formatter formatter;
 protected:
-  int sendResponse (L_Busmonitor_PDU * p, pth_event_t stop);
+  int queueResponse (L_Busmonitor_PDU * p, pth_event_t stop);
+  void startBatch ()
+  {
+    formatter.updateClock ();
+  }
 public:
   /** initializes busmonitor
    * @param c client connection
    * @param tr debug output
    * @param l3 Layer 3
    * @param virt is virtual busmonitor
+   * @param format output format (EIB_BUSMONITOR_FORMAT_*)
+   * @param hdr length of the open request before the filter
    */
-  A_Text_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr, bool virt = 0):A_Busmonitor (c, l3, tr,
+  A_Text_Busmonitor (ClientConnection * c, Layer3 * l3, Trace * tr, bool virt = 0, uchar format = EIB_BUSMONITOR_FORMAT_DECODE, unsigned hdr = 2):A_Busmonitor (c, l3, tr,
 		virt,
-		false)
+		false, hdr)
   {
+    this->format = format;
   }
 };
 
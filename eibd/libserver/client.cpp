@@ -19,6 +19,9 @@
 
 #include <errno.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include "server.h"
 #include "client.h"
 #include "busmonitor.h"
@@ -27,6 +30,13 @@
 #include "groupcacheclient.h"
 #include "config.h"
 
+/** open client connections */
+static Gauge connected ("clients.connected");
+/** processed requests */
+static Counter requests ("clients.requests");
+/** time to write a message to a client */
+static Histogram sendtime ("clients.send_us");
+
 ClientConnection::ClientConnection (Server * s, Layer3 * l3, Trace * tr,
 				    int fd)
 {
@@ -37,14 +47,31 @@ ClientConnection::ClientConnection (Server * s, Layer3 * l3, Trace * tr,
   this->s = s;
   buf = 0;
   buflen = 0;
+  down = false;
+  out = 0;
+  outlen = 0;
+  inpos = 0;
+  inlen = 0;
+  ring = 0;
+  cachecursor = 0;
+  cachecursorvalid = false;
+  connected.inc ();
 }
 
 ClientConnection::~ClientConnection ()
 {
   TRACEPRINTF (t, 8, this, "ClientConnection closed");
   s->deregister (this);
+  connected.dec ();
   if (buf)
     delete[]buf;
+  if (out)
+    delete[]out;
+  if (ring)
+    {
+      ring->close ();
+      delete ring;
+    }
   close (fd);
 }
 
@@ -57,6 +84,7 @@ ClientConnection::Run (pth_sem_t * stop1)
       if (readmessage (stop) == -1)
 	break;
       int msg = EIBTYPE (buf);
+      requests.inc ();
       switch (msg)
 	{
 	case EIB_OPEN_BUSMONITOR:
@@ -101,6 +129,21 @@ ClientConnection::Run (pth_sem_t * stop1)
 	  }
 	  break;
 
+	case EIB_OPEN_BUSMONITOR_FORMAT:
+	case EIB_OPEN_VBUSMONITOR_FORMAT:
+	  if (size < 3 || buf[2] > EIB_BUSMONITOR_FORMAT_JSON)
+	    {
+	      sendreject (stop, EIB_PROCESSING_ERROR);
+	      break;
+	    }
+	  {
+	    A_Text_Busmonitor busmon (this, l3, t,
+				      msg == EIB_OPEN_VBUSMONITOR_FORMAT,
+				      buf[2], 3);
+	    busmon.Do (stop);
+	  }
+	  break;
+
 	case EIB_OPEN_T_BROADCAST:
 	  {
 	    A_Broadcast cl (l3, t, this);
@@ -178,6 +221,11 @@ ClientConnection::Run (pth_sem_t * stop1)
 	case EIB_CACHE_READ:
 	case EIB_CACHE_READ_NOWAIT:
 	case EIB_CACHE_LAST_UPDATES:
+	case EIB_CACHE_CHANGES:
+	case EIB_OPEN_CACHE_FEED:
+	case EIB_CACHE_READ_MULTI:
+	case EIB_CACHE_HISTORY:
+	case EIB_CACHE_SCAN:
 #ifdef HAVE_GROUPCACHE
 	  GroupCacheRequest (l3, t, this, stop);
 #else
@@ -185,6 +233,14 @@ ClientConnection::Run (pth_sem_t * stop1)
 #endif
 	  break;
 
+	case EIB_GET_STATS:
+	  sendstats (stop);
+	  break;
+
+	case EIB_OPEN_SHM_RING:
+	  openring (stop);
+	  break;
+
 	case EIB_RESET_CONNECTION:
 	  sendreject (stop, EIB_RESET_CONNECTION);
 	  EIBSETTYPE (buf, EIB_INVALID_REQUEST);
@@ -216,47 +272,267 @@ ClientConnection::sendreject (pth_event_t stop, int type)
   return sendmessage (2, buf, stop);
 }
 
+int
+ClientConnection::senddropped (unsigned long count, pth_event_t stop)
+{
+  uchar buf[6];
+  EIBSETTYPE (buf, EIB_DROPPED_PACKETS);
+  buf[2] = (count >> 24) & 0xff;
+  buf[3] = (count >> 16) & 0xff;
+  buf[4] = (count >> 8) & 0xff;
+  buf[5] = (count) & 0xff;
+  return sendmessage (6, buf, stop);
+}
+
+int
+ClientConnection::sendstats (pth_event_t stop)
+{
+  char prefix[200];
+  unsigned len = size - 2;
+  CArray out;
+
+  /* the request may carry a name prefix */
+  if (len >= sizeof (prefix))
+    len = sizeof (prefix) - 1;
+  memcpy (prefix, buf + 2, len);
+  prefix[len] = 0;
+
+  out.resize (2);
+  EIBSETTYPE (out.array (), EIB_GET_STATS);
+  Metric::Dump (out, prefix);
+  if (out () > 0xffff)
+    {
+      /* truncate at a line end to fit into one message */
+      len = 0xffff;
+      while (len > 2 && out[len - 1] != '\n')
+	len--;
+      out.resize (len);
+    }
+  return sendmessage (out (), out.array (), stop);
+}
+
+void
+ClientConnection::disconnect ()
+{
+  if (down)
+    return;
+  TRACEPRINTF (t, 8, this, "Disconnect");
+  shutdown (fd, SHUT_RDWR);
+  down = true;
+}
+
+int
+ClientConnection::writeout (struct iovec *iov, int cnt, pth_event_t stop)
+{
+  ssize_t i;
+  while (cnt)
+    {
+      i = pth_writev_ev (fd, iov, cnt, stop);
+      if (i <= 0)
+	return -1;
+      /* skip the written part */
+      while (cnt && (size_t) i >= iov->iov_len)
+	{
+	  i -= iov->iov_len;
+	  iov++;
+	  cnt--;
+	}
+      if (cnt)
+	{
+	  iov->iov_base = (uchar *) iov->iov_base + i;
+	  iov->iov_len -= i;
+	}
+    }
+  return 0;
+}
+
 int
 ClientConnection::sendmessage (int size, const uchar * msg, pth_event_t stop)
 {
-  int i;
-  int start;
   uchar head[2];
+  struct iovec iov[3];
+  int cnt = 0;
   assert (size >= 2);
 
+  timestamp_t now = getMonotonicTime ();
   t->TracePacket (8, this, "SendMessage", size, msg);
+  if (ring)
+    {
+      if (ring->put (size, msg, stop) == -1)
+	return -1;
+      ring->signal ();
+      sendtime.since (now);
+      return 0;
+    }
   head[0] = (size >> 8) & 0xff;
   head[1] = (size) & 0xff;
 
-  i = pth_write_ev (fd, head, 2, stop);
-  if (i != 2)
+  if (outlen)
+    {
+      iov[cnt].iov_base = out;
+      iov[cnt].iov_len = outlen;
+      cnt++;
+    }
+  iov[cnt].iov_base = head;
+  iov[cnt].iov_len = 2;
+  cnt++;
+  iov[cnt].iov_base = (uchar *) msg;
+  iov[cnt].iov_len = size;
+  cnt++;
+  outlen = 0;
+  if (writeout (iov, cnt, stop) == -1)
     return -1;
+  sendtime.since (now);
+  return 0;
+}
+
+int
+ClientConnection::queuemessage (int size, const uchar * msg,
+				pth_event_t stop)
+{
+  assert (size >= 2);
+  if (ring)
+    {
+      t->TracePacket (8, this, "QueueMessage", size, msg);
+      return ring->put (size, msg, stop);
+    }
+  if (size + 2 > CLIENT_OUTBUF)
+    return sendmessage (size, msg, stop);
+  if (outlen + size + 2 > CLIENT_OUTBUF)
+    if (flush (stop) == -1)
+      return -1;
+  if (!out)
+    out = new uchar[CLIENT_OUTBUF];
+  t->TracePacket (8, this, "QueueMessage", size, msg);
+  out[outlen] = (size >> 8) & 0xff;
+  out[outlen + 1] = (size) & 0xff;
+  memcpy (out + outlen + 2, msg, size);
+  outlen += size + 2;
+  return 0;
+}
 
-  start = 0;
-lp:
-  i = pth_write_ev (fd, msg + start, size - start, stop);
-  if (i <= 0)
+int
+ClientConnection::flush (pth_event_t stop)
+{
+  struct iovec iov;
+  if (ring)
+    ring->signal ();
+  if (!outlen)
+    return 0;
+  timestamp_t now = getMonotonicTime ();
+  iov.iov_base = out;
+  iov.iov_len = outlen;
+  outlen = 0;
+  if (writeout (&iov, 1, stop) == -1)
     return -1;
-  start += i;
-  if (start < size)
-    goto lp;
+  sendtime.since (now);
+  return 0;
+}
+
+int
+ClientConnection::openring (pth_event_t stop)
+{
+  struct sockaddr_un sa;
+  socklen_t salen = sizeof (sa);
+  unsigned order = EIB_SHM_RING_ORDER;
+  uchar msg[5];
+  struct iovec iov;
+  struct msghdr mh;
+  union
+  {
+    struct cmsghdr h;
+    char data[CMSG_SPACE (3 * sizeof (int))];
+  } ctl;
+  int *fds;
+  ssize_t i;
+
+  /* the descriptors can only be passed over a unix socket */
+  if (ring || getsockname (fd, (struct sockaddr *) &sa, &salen) == -1
+      || sa.sun_family != AF_UNIX)
+    return sendreject (stop);
+  if (size >= 3 && buf[2])
+    order = buf[2];
+  ShmRing *r = new ShmRing;
+  if (!r->init (order))
+    {
+      TRACEPRINTF (t, 8, this, "Creating shared memory ring failed");
+      delete r;
+      return sendreject (stop, EIB_PROCESSING_ERROR);
+    }
+
+  msg[0] = 0;
+  msg[1] = 3;
+  EIBSETTYPE (msg + 2, EIB_OPEN_SHM_RING);
+  msg[4] = order;
+  t->TracePacket (8, this, "SendMessage", 3, msg + 2);
+  iov.iov_base = msg;
+  iov.iov_len = sizeof (msg);
+  memset (&mh, 0, sizeof (mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = ctl.data;
+  mh.msg_controllen = sizeof (ctl.data);
+  CMSG_FIRSTHDR (&mh)->cmsg_level = SOL_SOCKET;
+  CMSG_FIRSTHDR (&mh)->cmsg_type = SCM_RIGHTS;
+  CMSG_FIRSTHDR (&mh)->cmsg_len = CMSG_LEN (3 * sizeof (int));
+  fds = (int *) CMSG_DATA (CMSG_FIRSTHDR (&mh));
+  fds[0] = r->getMemFD ();
+  fds[1] = r->getDataFD ();
+  fds[2] = r->getSpaceFD ();
+  /* pth has no sendmsg wrapper, so wait for the socket to become
+   * writeable and send without blocking the other threads */
+  pth_event_t wev = pth_event (PTH_EVENT_FD | PTH_UNTIL_FD_WRITEABLE, fd);
+  do
+    {
+      i = sendmsg (fd, &mh, MSG_DONTWAIT);
+      if (i == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+	  if (stop)
+	    pth_event_concat (wev, stop, NULL);
+	  pth_wait (wev);
+	  if (stop)
+	    pth_event_isolate (wev);
+	  if (stop && pth_event_status (stop) == PTH_STATUS_OCCURRED)
+	    break;
+	  errno = EINTR;
+	}
+    }
+  while (i == -1 && errno == EINTR);
+  pth_event_free (wev, PTH_FREE_THIS);
+  if (i != sizeof (msg))
+    {
+      delete r;
+      return -1;
+    }
+  ring = r;
   return 0;
 }
 
 int
 ClientConnection::readmessage (pth_event_t stop)
 {
-  uchar head[2];
   int i;
   unsigned start;
 
-  i = pth_read_ev (fd, &head, 2, stop);
-  if (i != 2)
-    return -1;
+  /* read as much as available, until the header is complete */
+  while (inlen - inpos < 2)
+    {
+      if (inpos)
+	{
+	  memmove (in, in + inpos, inlen - inpos);
+	  inlen -= inpos;
+	  inpos = 0;
+	}
+      i = pth_read_ev (fd, in + inlen, CLIENT_INBUF - inlen, stop);
+      if (i <= 0)
+	return -1;
+      inlen += i;
+    }
 
-  size = (head[0] << 8) | (head[1]);
+  size = (in[inpos] << 8) | (in[inpos + 1]);
   if (size < 2)
     return -1;
+  inpos += 2;
 
   if (size > buflen)
     {
@@ -266,14 +542,34 @@ ClientConnection::readmessage (pth_event_t stop)
       buflen = size;
     }
 
-  start = 0;
-lp:
-  i = pth_read_ev (fd, buf + start, size - start, stop);
-  if (i <= 0)
-    return -1;
-  start += i;
-  if (start < size)
-    goto lp;
+  /* take the buffered part of the message */
+  start = inlen - inpos < size ? inlen - inpos : size;
+  memcpy (buf, in + inpos, start);
+  inpos += start;
+  if (inpos == inlen)
+    inpos = inlen = 0;
+
+  while (start < size)
+    {
+      if (size - start >= CLIENT_INBUF)
+	{
+	  /* read long messages directly */
+	  i = pth_read_ev (fd, buf + start, size - start, stop);
+	  if (i <= 0)
+	    return -1;
+	  start += i;
+	  continue;
+	}
+      i = pth_read_ev (fd, in, CLIENT_INBUF, stop);
+      if (i <= 0)
+	return -1;
+      inlen = i;
+      inpos = size - start < (unsigned) i ? size - start : i;
+      memcpy (buf + start, in, inpos);
+      start += inpos;
+      if (inpos == inlen)
+	inpos = inlen = 0;
+    }
 
   t->TracePacket (8, this, "RecvMessage", size, buf);
   return 0;
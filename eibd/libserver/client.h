@@ -22,12 +22,19 @@
 
 #include "common.h"
 #include "eibtypes.h"
+#include "metrics.h"
+#include "shmring.h"
 
 /** reads the type of a eibd packet */
 #define EIBTYPE(buf) (((buf)[0]<<8)|((buf)[1]))
 /** sets the type of a eibd packet*/
 #define EIBSETTYPE(buf,type) do{(buf)[0]=(type>>8)&0xff;(buf)[1]=(type)&0xff;}while(0)
 
+/** size of the output buffer of a client connection */
+#define CLIENT_OUTBUF 8192
+/** size of the receive buffer of a client connection */
+#define CLIENT_INBUF 4096
+
 class Server;
 class Layer3;
 /** implements a client connection */
@@ -43,6 +50,24 @@ class ClientConnection:public Thread
   Server *s;
   /** buffer length*/
   unsigned buflen;
+  /** connection was shut down by disconnect */
+  bool down;
+  /** queued messages, allocated on first use */
+  uchar *out;
+  /** used bytes of out */
+  unsigned outlen;
+  /** received data, which was not yet returned by readmessage */
+  uchar in[CLIENT_INBUF];
+  /** start of the unprocessed data in in */
+  unsigned inpos;
+  /** end of the received data in in */
+  unsigned inlen;
+  /** shared memory ring, which replaces the socket for all messages
+   * to the client, 0 if not used */
+  ShmRing *ring;
+
+  /** writes the buffers iov; aborts if stop occurs */
+  int writeout (struct iovec *iov, int cnt, pth_event_t stop);
 
   void Run (pth_sem_t * stop);
 public:
@@ -50,13 +75,34 @@ public:
     virtual ~ ClientConnection ();
     /** reads a message and stores it in buf; aborts if stop occurs */
   int readmessage (pth_event_t stop);
-  /** send a message and aborts if stop occurs */
+  /** send a message after the queued ones and aborts if stop occurs */
   int sendmessage (int size, const uchar * msg, pth_event_t stop);
+  /** queues a message to be sent with the next flush or sendmessage;
+   * sends the queue first, if it is full; aborts if stop occurs */
+  int queuemessage (int size, const uchar * msg, pth_event_t stop);
+  /** sends all queued messages at once; aborts if stop occurs */
+  int flush (pth_event_t stop);
   /** send a reject; aborts if stop occurs */
   int sendreject (pth_event_t stop);
   /** sends a reject with the code code; aborts, if stop occurs */
   int sendreject (pth_event_t stop, int code);
+  /** tells the client, how many packets were dropped because of a
+   * full queue; aborts, if stop occurs */
+  int senddropped (unsigned long count, pth_event_t stop);
+  /** sends the metrics report; aborts, if stop occurs */
+  int sendstats (pth_event_t stop);
+  /** switches the messages to the client to a shared memory ring;
+   * aborts, if stop occurs */
+  int openring (pth_event_t stop);
+  /** shuts down the connection; the pending and all further reads
+   * and writes fail */
+  void disconnect ();
+
 
+  /** position of the connection in the group cache change log */
+  uint32_t cachecursor;
+  /** cachecursor has been initialized */
+  bool cachecursorvalid;
 
   /** buffer*/
   uchar *buf;
@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <sys/time.h>
+#include <time.h>
 #include "common.h"
 
 
@@ -30,6 +31,17 @@ getTime ()
   return ((timestamp_t) t.tv_sec) * 1000000 + ((timestamp_t) t.tv_usec);
 }
 
+timestamp_t
+getMonotonicTime ()
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  if (clock_gettime (CLOCK_MONOTONIC, &t) == 0)
+    return ((timestamp_t) t.tv_sec) * 1000000000 + ((timestamp_t) t.tv_nsec);
+#endif
+  return getTime () * 1000;
+}
+
 String
 FormatEIBAddr (eibaddr_t addr)
 {
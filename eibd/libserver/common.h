@@ -69,6 +69,9 @@ void add16Hex (String & s, uint16_t c);
 
 /** get current time */
 timestamp_t getTime ();
+/** get a monotonic time in ns, which does not follow changes of the
+ * system clock; falls back to getTime, if the system has no monotonic clock */
+timestamp_t getMonotonicTime ();
 
 /** formats an EIB individual address */
 String FormatEIBAddr (eibaddr_t a);
@@ -49,7 +49,7 @@ A_Group::A_Group (Layer3 * l3, Trace * tr, ClientConnection * cc)
     return;
   c =
     new T_Group (layer3, t, (con->buf[2] << 8) | (con->buf[3]),
-		 con->buf[4] != 0 ? 1 : 0);
+		 con->buf[4] != 0 ? 1 : 0, this);
   if (!c->init ())
     {
       delete c;
@@ -125,9 +125,12 @@ A_GroupSocket::A_GroupSocket (Layer3 * l3, Trace * tr, ClientConnection * cc)
   layer3 = l3;
   con = cc;
   c = 0;
-  if (con->size != 5)
+  if (con->size < 5)
+    return;
+  if (!filter.init (con->buf + 5, con->size - 5))
     return;
-  c = new GroupSocket (layer3, t, con->buf[4] != 0 ? 1 : 0);
+  c = new GroupSocket (layer3, t, con->buf[4] != 0 ? 1 : 0, this,
+		       filter.empty ()? 0 : &filter);
   if (!c->init ())
     {
       delete c;
@@ -370,15 +373,39 @@ A_Broadcast::Run (pth_sem_t * stop1)
   pth_event_free (stop, PTH_FREE_THIS);
 }
 
+void
+A_Group::Overflow ()
+{
+  TRACEPRINTF (t, 7, this, "Queue overflow, disconnecting");
+  con->disconnect ();
+}
+
+void
+A_GroupSocket::Overflow ()
+{
+  TRACEPRINTF (t, 7, this, "Queue overflow, disconnecting");
+  con->disconnect ();
+}
+
 void
 A_Group::Run (pth_sem_t * stop1)
 {
+  unsigned long dropped = 0;
   pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
   while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
     {
       GroupComm *e = c->Get (stop);
       if (e)
 	{
+	  if (c->dropped () != dropped)
+	    {
+	      dropped = c->dropped ();
+	      if (con->senddropped (dropped, stop) == -1)
+		{
+		  delete e;
+		  goto out;
+		}
+	    }
 	  CArray res;
 	  res.resize (4 + e->data ());
 	  EIBSETTYPE (res, EIB_APDU_PACKET);
@@ -390,6 +417,7 @@ A_Group::Run (pth_sem_t * stop1)
 	  delete e;
 	}
     }
+out:
   pth_event_free (stop, PTH_FREE_THIS);
 }
 
@@ -461,12 +489,22 @@ A_Connection::Run (pth_sem_t * stop1)
 void
 A_GroupSocket::Run (pth_sem_t * stop1)
 {
+  unsigned long dropped = 0;
   pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
   while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
     {
       GroupAPDU *e = c->Get (stop);
       if (e)
 	{
+	  if (c->dropped () != dropped)
+	    {
+	      dropped = c->dropped ();
+	      if (con->senddropped (dropped, stop) == -1)
+		{
+		  delete e;
+		  goto out;
+		}
+	    }
 	  CArray res;
 	  res.resize (6 + e->data ());
 	  EIBSETTYPE (res, EIB_GROUP_PACKET);
@@ -480,5 +518,6 @@ A_GroupSocket::Run (pth_sem_t * stop1)
 	  delete e;
 	}
     }
+out:
   pth_event_free (stop, PTH_FREE_THIS);
 }
@@ -41,7 +41,7 @@ public:
 };
 
 /** implements client interface to a group connection */
-class A_Group:private Thread
+class A_Group:private Thread, private Overflow_CallBack
 {
   Layer3 *layer3;
   Trace *t;
@@ -49,6 +49,7 @@ class A_Group:private Thread
   T_Group *c;
 
   void Run (pth_sem_t * stop);
+  void Overflow ();
 public:
     A_Group (Layer3 * l3, Trace * tr, ClientConnection * cc);
    ~A_Group ();
@@ -109,14 +110,17 @@ public:
 };
 
 /** implements client interface to a group socket */
-class A_GroupSocket:private Thread
+class A_GroupSocket:private Thread, private Overflow_CallBack
 {
   Layer3 *layer3;
   Trace *t;
   ClientConnection *con;
   GroupSocket *c;
+  /** packets, which should be delivered */
+  FrameFilter filter;
 
   void Run (pth_sem_t * stop);
+  void Overflow ();
 public:
     A_GroupSocket (Layer3 * l3, Trace * tr, ClientConnection * cc);
    ~A_GroupSocket ();
@@ -232,6 +232,7 @@ compareIPAddress (const struct sockaddr_in & a, const struct sockaddr_in & b)
 EIBNetIPPacket::EIBNetIPPacket ()
 {
   service = 0;
+  arrival = 0;
   memset (&src, 0, sizeof (src));
 }
 
@@ -462,6 +463,7 @@ EIBNetIPSocket::Run (pth_sem_t * stop1)
 		EIBNetIPPacket::fromPacket (CArray (buf, i), r);
 	      if (p)
 		{
+		  p->arrival = getMonotonicTime ();
 		  outqueue.put (*p);
 		  delete p;
 		  pth_sem_inc (&outsignal, 1);
@@ -68,6 +68,8 @@ public:
   CArray data;
   /** source address */
   struct sockaddr_in src;
+  /** time of the arrival (getMonotonicTime), 0 if not received */
+  timestamp_t arrival;
 
     EIBNetIPPacket ();
     /** create from character array */
@@ -31,6 +31,11 @@ EIBnetServer::EIBnetServer (const char *multicastaddr, int port, bool Tunnel,
   struct ip_mreq mcfg;
   t = tr;
   l3 = layer3;
+  clients.setName ("eibnetserver.clients");
+  received.setName ("eibnetserver.received");
+  forward.setName ("eibnetserver.forward_us");
+  sent.setName ("eibnetserver.sent");
+  dropped.setName ("eibnetserver.dropped");
 
   TRACEPRINTF (t, 8, this, "Open");
   memset (&baddr, 0, sizeof (baddr));
@@ -134,10 +139,10 @@ EIBnetServer::Get_L_Busmonitor (L_Busmonitor_PDU * l)
     {
       if (state[i].type == 1)
 	{
-	  state[i].out.put (Busmonitor_to_CEMI (0x2B, *l, state[i].no++));
-	  pth_sem_inc (state[i].outsignal, 0);
+	addOutput (i, Busmonitor_to_CEMI (0x2B, *l, state[i].no++));
 	}
     }
+  l->unref ();
 }
 
 
@@ -147,18 +152,24 @@ EIBnetServer::Get_L_Data (L_Data_PDU * l)
   if (!l->hopcount)
     {
       TRACEPRINTF (t, 8, this, "SendDrop");
-      delete l;
+      l->unref ();
       return;
     }
   if (l->object == this)
     {
-      delete l;
+      l->unref ();
       return;
     }
-  l->hopcount--;
+  if (l->arrival)
+    forward.since (l->arrival);
+  /* the frame is shared, so the decremented hop count is only
+   * patched into the cEMI frame */
+  CArray c = L_Data_ToCEMI (0x29, *l);
+  c[3] = (c[3] & 0x8f) | (((l->hopcount - 1) & 0x07) << 4);
   if (route)
     {
       TRACEPRINTF (t, 8, this, "Send_Route %s", l->Decode ()());
+      sent.inc ();
       sock->sendaddr = maddr;
       EIBNetIPPacket p;
       p.service = ROUTING_INDICATION;
@@ -168,33 +179,54 @@ EIBnetServer::Get_L_Data (L_Data_PDU * l)
 	  for (i = 0; i < natstate (); i++)
 	    if (natstate[i].dest == l->source)
 	      {
-		l->dest = natstate[i].src;
-		p.data = L_Data_ToCEMI (0x29, *l);
+		p.data = c;
+		p.data[6] = (natstate[i].src >> 8) & 0xff;
+		p.data[7] = (natstate[i].src) & 0xff;
 		sock->Send (p);
-		l->dest = 0;
 		cnt++;
 	      }
 	  if (!cnt)
 	    {
-	      p.data = L_Data_ToCEMI (0x29, *l);
+	      p.data = c;
 	      sock->Send (p);
 	    }
 	}
       else
 	{
-	  p.data = L_Data_ToCEMI (0x29, *l);
+	  p.data = c;
 	  sock->Send (p);
 	}
     }
   for (int i = 0; i < state (); i++)
     {
       if (state[i].type == 0)
-	{
-	  state[i].out.put (L_Data_ToCEMI (0x29, *l));
-	  pth_sem_inc (state[i].outsignal, 0);
-	}
+	addOutput (i, c);
     }
-  delete l;
+  l->unref ();
+}
+
+void
+EIBnetServer::addOutput (int i, const CArray & c)
+{
+  ConnState & s = state[i];
+  if (!s.out.full ())
+    {
+      sent.inc ();
+      s.out.put (c);
+      pth_sem_inc (s.outsignal, 0);
+      return;
+    }
+  dropped.inc ();
+  /* the queue head is removed only, after the client acknowledged it */
+  if (s.out.overflow () && !s.state)
+    {
+      s.out.get ();
+      s.out.put (c);
+    }
+  TRACEPRINTF (t, 8, this, "Queue full %d, %lu dropped", s.channel,
+	       s.out.dropped);
+  if (s.out.disconnect)
+    pth_event (PTH_EVENT_RTIME | PTH_MODE_REUSE, s.timeout, pth_time (0, 0));
 }
 
 void
@@ -246,6 +278,8 @@ rt:
       state[pos].no = 1;
       state[pos].type = type;
       state[pos].nat = r1.nat;
+      state[pos].out.setLimit (l3->queuelimit);
+      clients.set (state ());
     }
   return id;
 }
@@ -374,12 +408,14 @@ EIBnetServer::Run (pth_sem_t * stop1)
 	      L_Data_PDU *c = CEMI_to_L_Data (data);
 	      if (c)
 		{
+		  c->arrival = p1->arrival;
 		  TRACEPRINTF (t, 8, this, "Recv_Route %s", c->Decode ()());
 		  if (c->hopcount)
 		    {
 		      c->hopcount--;
 		      addNAT (*c);
 		      c->object = this;
+		      received.inc ();
 		      l3->send_L_Data (c);
 		    }
 		  else
@@ -433,6 +469,7 @@ EIBnetServer::Run (pth_sem_t * stop1)
 			if (state[i].type == 1)
 			  delBusmonitor ();
 			state.deletepart (i, 1);
+			clients.set (state ());
 			break;
 		      }
 		    else
@@ -524,18 +561,21 @@ EIBnetServer::Run (pth_sem_t * stop1)
 		  L_Data_PDU *c = CEMI_to_L_Data (r1.CEMI);
 		  if (c)
 		    {
+		      c->arrival = p1->arrival;
 		      r2.status = 0;
 		      if (c->hopcount)
 			{
 			  c->hopcount--;
 			  if (r1.CEMI[0] == 0x11)
 			    {
-			      state[i].out.put (L_Data_ToCEMI (0x2E, *c));
-			      pth_sem_inc (state[i].outsignal, 0);
+			      addOutput (i, L_Data_ToCEMI (0x2E, *c));
 			    }
 			  c->object = this;
 			  if (r1.CEMI[0] == 0x11 || r1.CEMI[0] == 0x29)
-			    l3->send_L_Data (c);
+			    {
+			      received.inc ();
+			      l3->send_L_Data (c);
+			    }
 			  else
 			    delete c;
 			}
@@ -671,8 +711,7 @@ EIBnetServer::Run (pth_sem_t * stop1)
 			  CEMI[6] = start & 0xff;
 			  CEMI.setpart (res, 7);
 			  r2.status = 0x00;
-			  state[i].out.put (CEMI);
-			  pth_sem_inc (state[i].outsignal, 0);
+			  addOutput (i, CEMI);
 			}
 		      else
 			r2.status = 0x26;
@@ -738,6 +777,20 @@ EIBnetServer::Run (pth_sem_t * stop1)
       for (i = 0; i < state (); i++)
 	if (pth_event_status (state[i].timeout) == PTH_STATUS_OCCURRED)
 	  {
+	    if (state[i].out.disconnect)
+	      {
+		EIBnet_DisconnectRequest r;
+		TRACEPRINTF (t, 8, this, "Queue overflow, disconnect %d",
+			     state[i].channel);
+		r.channel = state[i].channel;
+		if (GetSourceAddress (&state[i].caddr, &r.caddr))
+		  {
+		    r.caddr.sin_port = Port;
+		    r.nat = state[i].nat;
+		    sock->sendaddr = state[i].caddr;
+		    sock->Send (r.ToPacket ());
+		  }
+	      }
 	    pth_event_free (state[i].timeout, PTH_FREE_THIS);
 	    pth_event_free (state[i].sendtimeout, PTH_FREE_THIS);
 	    pth_event_free (state[i].outwait, PTH_FREE_THIS);
@@ -745,6 +798,7 @@ EIBnetServer::Run (pth_sem_t * stop1)
 	    if (state[i].type == 1)
 	      delBusmonitor ();
 	    state.deletepart (i, 1);
+	    clients.set (state ());
 	    break;
 	  }
       for (i = 0; i < state (); i++)
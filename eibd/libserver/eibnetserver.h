@@ -33,7 +33,7 @@ typedef struct
   int no;
   bool nat;
   pth_event_t timeout;
-    Queue < CArray > out;
+    BoundedQueue < CArray > out;
   struct sockaddr_in daddr;
   struct sockaddr_in caddr;
   pth_sem_t *outsignal;
@@ -62,6 +62,16 @@ class EIBnetServer:public L_Data_CallBack, public L_Busmonitor_CallBack,
   struct sockaddr_in maddr;
     Array < ConnState > state;
     Array < NATState > natstate;
+  /** number of tunnel connections */
+  Gauge clients;
+  /** frames received from clients and routers */
+  Counter received;
+  /** frames sent to clients and routers */
+  Counter sent;
+  /** frames dropped because of a full client queue */
+  Counter dropped;
+  /** time from the arrival of a frame to its forwarding to clients */
+  Histogram forward;
 
   void Run (pth_sem_t * stop);
   void Get_L_Data (L_Data_PDU * l);
@@ -70,6 +80,8 @@ class EIBnetServer:public L_Data_CallBack, public L_Busmonitor_CallBack,
   void delBusmonitor ();
   int addClient (int type, const EIBnet_ConnectRequest & r1);
   void addNAT (const L_Data_PDU & l);
+  /** queues a cEMI frame for the client i, applying the queue limit */
+  void addOutput (int i, const CArray & c);
 public:
     EIBnetServer (const char *multicastaddr, int port, bool Tunnel,
 		  bool Route, bool Discover, Layer3 * layer3, Trace * tr);
@@ -120,14 +120,22 @@ CArray
 Busmonitor_to_CEMI (uchar code, const L_Busmonitor_PDU & p, int no)
 {
   CArray pdu;
-  pdu.resize (p.pdu () + 6);
+  uint32_t stamp = p.arrival / 1000;
+  pdu.resize (p.pdu () + 12);
   pdu[0] = code;
-  pdu[1] = 4;
-  pdu[2] = 3;
-  pdu[3] = 1;
-  pdu[4] = 1;
-  pdu[5] = no & 0x7;
-  pdu.setpart (p.pdu, 6);
+  pdu[1] = 10;
+  /* extended relative timestamp in us */
+  pdu[2] = 6;
+  pdu[3] = 4;
+  pdu[4] = (stamp >> 24) & 0xff;
+  pdu[5] = (stamp >> 16) & 0xff;
+  pdu[6] = (stamp >> 8) & 0xff;
+  pdu[7] = (stamp) & 0xff;
+  pdu[8] = 3;
+  pdu[9] = 1;
+  pdu[10] = 1;
+  pdu[11] = no & 0x7;
+  pdu.setpart (p.pdu, 12);
   return pdu;
 }
 
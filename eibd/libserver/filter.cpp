@@ -0,0 +1,193 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <string.h>
+#include "filter.h"
+#include "eibtypes.h"
+
+/** reads a big endian address */
+static inline eibaddr_t
+getaddr (const uchar * p)
+{
+  return (p[0] << 8) | (p[1]);
+}
+
+FrameFilter::FrameFilter ()
+{
+  groups = 0;
+  apci = 0;
+  frames = 0;
+}
+
+FrameFilter::~FrameFilter ()
+{
+  if (groups)
+    delete[]groups;
+}
+
+void
+FrameFilter::allocGroups ()
+{
+  if (groups)
+    return;
+  groups = new uint32_t[0x10000 / 32];
+  memset (groups, 0, 0x10000 / 8);
+}
+
+bool
+FrameFilter::init (const uchar * data, unsigned len)
+{
+  unsigned pos = 0, i, j;
+  while (pos < len)
+    switch (data[pos])
+      {
+      case EIB_FILTER_GROUP_RANGE:
+	if (pos + 5 > len)
+	  return false;
+	if (getaddr (data + pos + 1) > getaddr (data + pos + 3))
+	  return false;
+	allocGroups ();
+	for (i = getaddr (data + pos + 1); i <= getaddr (data + pos + 3); i++)
+	  groups[i >> 5] |= 1U << (i & 31);
+	pos += 5;
+	break;
+
+      case EIB_FILTER_GROUP_BITMAP:
+	if (pos + 4 > len || pos + 4 + data[pos + 3] > len)
+	  return false;
+	j = getaddr (data + pos + 1);
+	if (j + data[pos + 3] * 8 > 0x10000)
+	  return false;
+	allocGroups ();
+	for (i = 0; i < data[pos + 3] * 8U; i++)
+	  if (data[pos + 4 + i / 8] & (1 << (i % 8)))
+	    groups[(j + i) >> 5] |= 1U << ((j + i) & 31);
+	pos += 4 + data[pos + 3];
+	break;
+
+      case EIB_FILTER_SOURCE:
+	if (pos + 5 > len)
+	  return false;
+	sources.resize (sources () + 1);
+	sources[sources () - 1].mask = getaddr (data + pos + 3);
+	sources[sources () - 1].value =
+	  getaddr (data + pos + 1) & sources[sources () - 1].mask;
+	pos += 5;
+	break;
+
+      case EIB_FILTER_APCI:
+	if (pos + 2 > len || !data[pos + 1])
+	  return false;
+	apci |= data[pos + 1];
+	pos += 2;
+	break;
+
+      case EIB_FILTER_FRAME:
+	if (pos + 2 > len || !data[pos + 1])
+	  return false;
+	frames |= data[pos + 1];
+	pos += 2;
+	break;
+
+      default:
+	return false;
+      }
+  return true;
+}
+
+bool
+FrameFilter::matchData (eibaddr_t src, eibaddr_t dest, bool group,
+			const uchar * tpdu, unsigned len) const
+{
+  unsigned i;
+  if (groups)
+    {
+      if (!group || !(groups[dest >> 5] & (1U << (dest & 31))))
+	return false;
+    }
+  if (sources ())
+    {
+      for (i = 0; i < sources (); i++)
+	if ((src & sources[i].mask) == sources[i].value)
+	  break;
+      if (i == sources ())
+	return false;
+    }
+  if (apci)
+    {
+      uchar c = EIB_FILTER_APCI_OTHER;
+      /* only T_DATA_XXX_REQ PDUs carry an A_GroupValue service */
+      if (len >= 2 && (tpdu[0] & 0xfc) == 0)
+	switch (((tpdu[0] & 0x03) << 2) | (tpdu[1] >> 6))
+	  {
+	  case 0:
+	    c = EIB_FILTER_APCI_READ;
+	    break;
+	  case 1:
+	    c = EIB_FILTER_APCI_RESPONSE;
+	    break;
+	  case 2:
+	    c = EIB_FILTER_APCI_WRITE;
+	    break;
+	  }
+      if (!(apci & c))
+	return false;
+    }
+  return true;
+}
+
+bool
+FrameFilter::match (const L_Data_PDU * l) const
+{
+  if (frames && !(frames & EIB_FILTER_FRAME_DATA))
+    return false;
+  return matchData (l->source, l->dest, l->AddrType == GroupAddress,
+		    l->data.array (), l->data ());
+}
+
+bool
+FrameFilter::match (const L_Busmonitor_PDU * l) const
+{
+  const CArray & c = l->pdu;
+  uchar type = EIB_FILTER_FRAME_OTHER;
+
+  if (c () == 1 && (c[0] == 0xCC || c[0] == 0xC0 || c[0] == 0x0C))
+    type = EIB_FILTER_FRAME_ACK;
+  else if (c () >= 1 && (c[0] & 0x53) == 0x10)
+    type = EIB_FILTER_FRAME_DATA;
+  if (frames && !(frames & type))
+    return false;
+  if (!groups && !sources () && !apci)
+    return true;
+  if (type != EIB_FILTER_FRAME_DATA)
+    return false;
+
+  /* the frame is checked in place, without creating a L_Data_PDU */
+  if (c[0] & 0x80)
+    {
+      if (c () < 8)
+	return false;
+      return matchData ((c[1] << 8) | c[2], (c[3] << 8) | c[4],
+			c[5] & 0x80, c.array () + 6, c () - 7);
+    }
+  if (c () < 9)
+    return false;
+  return matchData ((c[2] << 8) | c[3], (c[4] << 8) | c[5],
+		    c[1] & 0x80, c.array () + 7, c () - 8);
+}
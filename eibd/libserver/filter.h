@@ -0,0 +1,80 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "lpdu.h"
+
+/** accepted source addresses: (source & mask) == value */
+typedef struct
+{
+  eibaddr_t value;
+  eibaddr_t mask;
+} FilterSource;
+
+/** subscription filter of a group socket or busmonitor
+ *
+ * The filter is built from the items of an open request (EIB_FILTER_*).
+ * Items of the same kind are alternatives, items of different kinds
+ * must all match. Layer 3 checks it before a frame is passed to the
+ * callback, so rejected frames cost no queue entry and no wakeup.
+ */
+class FrameFilter
+{
+  /** bitmap of accepted group addresses, 0 accepts all addresses */
+  uint32_t *groups;
+  /** accepted source addresses, empty accepts all */
+    Array < FilterSource > sources;
+  /** accepted APCI classes (EIB_FILTER_APCI_*), 0 accepts all */
+  uchar apci;
+  /** accepted frame types (EIB_FILTER_FRAME_*), 0 accepts all */
+  uchar frames;
+
+  /** allocates an empty group address bitmap */
+  void allocGroups ();
+  /** checks the addresses and the APCI of a data frame
+   * @param group destination is a group address
+   * @param tpdu transport layer PDU
+   * @param len length of tpdu
+   */
+  bool matchData (eibaddr_t src, eibaddr_t dest, bool group,
+		  const uchar * tpdu, unsigned len) const;
+public:
+    FrameFilter ();
+    virtual ~ FrameFilter ();
+
+  /** parses the filter items of an open request
+   * @param data items
+   * @param len length of data
+   * @return false, if the items are malformed
+   */
+  bool init (const uchar * data, unsigned len);
+  /** returns true, if the filter accepts every frame */
+  bool empty () const
+  {
+    return !groups && !sources () && !apci && !frames;
+  }
+  /** returns true, if l should be delivered */
+  bool match (const L_Data_PDU * l) const;
+  /** returns true, if l should be delivered */
+  bool match (const L_Busmonitor_PDU * l) const;
+};
+
+#endif
@@ -17,18 +17,49 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "groupcache.h"
 #include "tpdu.h"
 #include "apdu.h"
 
-GroupCache::GroupCache (Layer3 * l3, Trace * t)
+GroupCache::GroupCache (Layer3 * l3, Trace * t, unsigned logsize)
 {
   TRACEPRINTF (t, 4, this, "GroupCacheInit");
   this->t = t;
   this->layer3 = l3;
   this->enable = 0;
-  pos = 0;
-  memset (updates, 0, sizeof (updates));
+  /* a power of 2 divides 2^32, so log[logpos % logsize] stays in
+   * sequence, when logpos wraps */
+  this->logsize = 1;
+  while (this->logsize < logsize && this->logsize < 0x80000000U)
+    this->logsize <<= 1;
+  logsize = this->logsize;
+  log = new GroupCacheChange[logsize];
+  logpos = 0;
+  count = 0;
+  saver = 0;
+  dirty = false;
+  setReadRate (GROUPCACHE_READRATE);
+  proxyage = 0;
+  recentpos = 0;
+  memset (recent, 0, sizeof (recent));
+  memset (pages, 0, sizeof (pages));
+  memset (present, 0, sizeof (present));
+  hits.setName ("groupcache.hits");
+  misses.setName ("groupcache.misses");
+  updated.setName ("groupcache.updates");
+  coalesced.setName ("groupcache.reads.coalesced");
+  limited.setName ("groupcache.reads.limited");
+  answered.setName ("groupcache.proxy.answered");
+  suppressed.setName ("groupcache.proxy.suppressed");
+  entries.setName ("groupcache.entries");
   pth_mutex_init (&mutex);
   pth_cond_init (&cond);
 }
@@ -36,106 +67,129 @@ GroupCache::GroupCache (Layer3 * l3, Trace * t)
 GroupCache::~GroupCache ()
 {
   TRACEPRINTF (t, 4, this, "GroupCacheDestroy");
+  setProxy (0);
   if (enable)
     layer3->deregisterGroupCallBack (this, 0);
+  if (saver)
+    delete saver;
   Clear ();
+  for (unsigned i = 0; i < 0x100; i++)
+    if (pages[i])
+      {
+	for (unsigned j = 0; j < 0x100; j++)
+	  if (pages[i]->slot[j].ext)
+	    delete[]pages[i]->slot[j].ext;
+	delete pages[i];
+      }
+  delete[]log;
+  for (unsigned i = 0; i < history (); i++)
+    delete[]history[i].ring;
 }
 
-GroupCacheEntry *
-GroupCache::find (eibaddr_t dst)
+GroupCacheEntry
+  GroupCache::entry (eibaddr_t dst, const GroupCacheSlot * s)
 {
-  int l = 0, r = cache () - 1;
-  while (l <= r)
-    {
-      int p = (l + r) / 2;
-      if (cache[p]->dst == dst)
-	return cache[p];
-      if (dst > cache[p]->dst)
-	l = p + 1;
-      else
-	r = p - 1;
-    }
-  return 0;
+  GroupCacheEntry e;
+  e.src = s->src;
+  e.dst = dst;
+  e.recvtime = s->recvtime;
+  e.data.set (s->len > GROUPCACHE_INLINE ? s->ext : s->data, s->len);
+  return e;
 }
 
-void
-GroupCache::remove (eibaddr_t addr)
+GroupCacheSlot *
+GroupCache::add (eibaddr_t dst, eibaddr_t src, const uchar * data,
+		 unsigned len)
 {
-  TRACEPRINTF (t, 4, this, "GroupCacheRemove %d/%d/%d", (addr >> 11) & 0x1f,
-	       (addr >> 8) & 0x07, (addr) & 0xff);
-
-  int l = 0, r = cache () - 1;
-  while (l <= r)
+  GroupCachePage *p = pages[dst >> 8];
+  if (!p)
+    {
+      p = new GroupCachePage;
+      memset (p, 0, sizeof (*p));
+      pages[dst >> 8] = p;
+    }
+  GroupCacheSlot *s = &p->slot[dst & 0xff];
+  if (len > 0xffff)
+    len = 0xffff;
+  if (len > GROUPCACHE_INLINE)
     {
-      int p = (l + r) / 2;
-      if (cache[p]->dst == addr)
+      if (s->extlen < len)
 	{
-	  delete cache[p];
-	  cache.deletepart (p, 1);
-	  return;
+	  if (s->ext)
+	    delete[]s->ext;
+	  s->ext = new uchar[len];
+	  s->extlen = len;
 	}
-      if (addr > cache[p]->dst)
-	l = p + 1;
-      else
-	r = p - 1;
+      memcpy (s->ext, data, len);
     }
-  return;
+  else if (len)
+    memcpy (s->data, data, len);
+  s->len = len;
+  s->src = src;
+  s->recvtime = time (0);
+  dirty = true;
+  if (!(present[dst >> 5] & (1U << (dst & 0x1f))))
+    {
+      present[dst >> 5] |= 1U << (dst & 0x1f);
+      count++;
+      entries.set (count);
+    }
+  return s;
 }
 
 void
-GroupCache::add (GroupCacheEntry * entry)
+GroupCache::remove (eibaddr_t addr)
 {
-  unsigned p;
-  cache.resize (cache () + 1);
-  p = cache () - 1;
-  while (p > 0 && cache[p - 1]->dst > entry->dst)
+  TRACEPRINTF (t, 4, this, "GroupCacheRemove %d/%d/%d", (addr >> 11) & 0x1f,
+	       (addr >> 8) & 0x07, (addr) & 0xff);
+
+  if (!find (addr))
+    return;
+  present[addr >> 5] &= ~(1U << (addr & 0x1f));
+  unsigned depth;
+  GroupCacheRing **r = historyRing (addr, depth);
+  if (r && *r)
     {
-      cache[p] = cache[p - 1];
-      p--;
+      free (*r);
+      *r = 0;
     }
-  cache[p] = entry;
+  dirty = true;
+  count--;
+  entries.set (count);
 }
 
-
 void
 GroupCache::Get_L_Data (L_Data_PDU * l)
 {
-  GroupCacheEntry *c;
-  if (enable)
+  /* the answers of Respond are no new values */
+  if (enable && l->object != this)
     {
-      TPDU *t = TPDU::fromPacket (l->data);
-      if (t->getType () == T_DATA_XXX_REQ)
+      APDU_View a;
+      /* a T_DATA_XXX_REQ TPDU carries the APDU without further header */
+      if (l->data () >= 1 && (l->data[0] & 0xfc) == 0 && a.init (l->data)
+	  && (a.type == A_GroupValue_Response
+	      || a.type == A_GroupValue_Write))
 	{
-	  T_DATA_XXX_REQ_PDU *t1 = (T_DATA_XXX_REQ_PDU *) t;
-	  if (t1->data () >= 2 && !(t1->data[0] & 0x3) &&
-	      ((t1->data[1] & 0xC0) == 0x40 || (t1->data[1] & 0xC0) == 0x80))
-	    {
-	      c = find (l->dest);
-	      updates[pos & 0xff] = l->dest;
-	      pos++;
-	      if (c)
-		{
-		  c->data = t1->data;
-		  c->src = l->source;
-		  c->dst = l->dest;
-		  c->recvtime = time (0);
-		  pth_cond_notify (&cond, 1);
-		}
-	      else
-		{
-		  c = new GroupCacheEntry;
-		  c->data = t1->data;
-		  c->src = l->source;
-		  c->dst = l->dest;
-		  c->recvtime = time (0);
-		  add (c);
-		  pth_cond_notify (&cond, 1);
-		}
-	    }
+	  GroupCacheChange & c = log[logpos % logsize];
+	  updated.inc ();
+	  GroupCacheSlot *s =
+	    add (l->dest, l->source, l->data.array (), l->data ());
+	  addHistory (l->dest, l->source, l->data.array (), l->data (),
+		      l->arrival ? l->arrival : getMonotonicTime ());
+	  c.dst = l->dest;
+	  c.src = l->source;
+	  c.recvtime = s->recvtime;
+	  c.len = l->data ();
+	  memcpy (c.data, l->data.array (),
+		  c.len < GROUPCACHE_INLINE ? c.len : GROUPCACHE_INLINE);
+	  logpos++;
+	  pth_cond_notify (&cond, 1);
+	  for (unsigned i = 0; i < pending (); i++)
+	    if (pending[i]->dst == l->dest)
+	      pth_cond_notify (&pending[i]->cond, 1);
 	}
-      delete t;
     }
-  delete l;
+  l->unref ();
 }
 
 bool
@@ -152,11 +206,12 @@ GroupCache::Start ()
 void
 GroupCache::Clear ()
 {
-  int i;
   TRACEPRINTF (t, 4, this, "GroupCacheClear");
-  for (i = 0; i < cache (); i++)
-    delete cache[i];
-  cache.resize (0);
+  memset (present, 0, sizeof (present));
+  clearHistory ();
+  dirty = true;
+  count = 0;
+  entries.set (0);
 }
 
 void
@@ -176,7 +231,7 @@ GroupCacheEntry
 	       (addr >> 11) & 0x1f, (addr >> 8) & 0x07, (addr) & 0xff,
 	       Timeout, age);
   bool rm = false;
-  GroupCacheEntry *c;
+  GroupCacheSlot *c;
   if (!enable)
     {
       GroupCacheEntry f;
@@ -195,8 +250,10 @@ GroupCacheEntry
       TRACEPRINTF (t, 4, this, "GroupCache found: %d.%d.%d",
 		   (c->src >> 12) & 0xf, (c->src >> 8) & 0xf,
 		   (c->src) & 0xff);
-      return *c;
+      hits.inc ();
+      return entry (addr, c);
     }
+  misses.inc ();
 
   if (!Timeout)
     {
@@ -207,19 +264,9 @@ GroupCacheEntry
       return f;
     }
 
-  A_GroupValue_Read_PDU apdu;
-  T_DATA_XXX_REQ_PDU tpdu;
-  L_Data_PDU *l;
+  GroupCachePending *p = attach (addr);
   pth_event_t timeout = pth_event (PTH_EVENT_RTIME, pth_time (Timeout, 0));
 
-  tpdu.data = apdu.ToPacket ();
-  l = new L_Data_PDU;
-  l->data = tpdu.ToPacket ();
-  l->source = 0;
-  l->dest = addr;
-  l->AddrType = GroupAddress;
-  layer3->send_L_Data (l);
-
   do
     {
       c = find (addr);
@@ -232,8 +279,9 @@ GroupCacheEntry
 	  TRACEPRINTF (t, 4, this, "GroupCache found: %d.%d.%d",
 		       (c->src >> 12) & 0xf, (c->src >> 8) & 0xf,
 		       (c->src) & 0xff);
+	  detach (p);
 	  pth_event_free (timeout, PTH_FREE_THIS);
-	  return *c;
+	  return entry (addr, c);
 	}
 
       if (pth_event_status (timeout) == PTH_STATUS_OCCURRED && c)
@@ -242,76 +290,657 @@ GroupCacheEntry
 	  gc.src = 0;
 	  gc.dst = addr;
 	  TRACEPRINTF (t, 4, this, "GroupCache reread timeout");
+	  detach (p);
 	  pth_event_free (timeout, PTH_FREE_THIS);
 	  return gc;
 	}
 
       if (pth_event_status (timeout) == PTH_STATUS_OCCURRED)
 	{
-	  c = new GroupCacheEntry;
-	  c->src = 0;
-	  c->dst = addr;
-	  c->recvtime = time (0);
-	  add (c);
+	  c = add (addr, 0, 0, 0);
 	  TRACEPRINTF (t, 4, this, "GroupCache timeout");
+	  detach (p);
 	  pth_event_free (timeout, PTH_FREE_THIS);
-	  return *c;
+	  return entry (addr, c);
+	}
+
+      if (!p->sent)
+	{
+	  request (p, timeout);
+	  continue;
 	}
 
       pth_mutex_acquire (&mutex, 0, 0);
-      pth_cond_await (&cond, &mutex, timeout);
+      pth_cond_await (&p->cond, &mutex, timeout);
       pth_mutex_release (&mutex);
     }
   while (1);
 }
 
+GroupCachePending *
+GroupCache::attach (eibaddr_t dst)
+{
+  GroupCachePending *p;
+  for (unsigned i = 0; i < pending (); i++)
+    if (pending[i]->dst == dst)
+      {
+	p = pending[i];
+	p->waiters++;
+	coalesced.inc ();
+	return p;
+      }
+  p = new GroupCachePending;
+  p->dst = dst;
+  p->waiters = 1;
+  p->sent = false;
+  p->sending = false;
+  pth_cond_init (&p->cond);
+  pending.add (p);
+  return p;
+}
+
+void
+GroupCache::detach (GroupCachePending * p)
+{
+  if (--p->waiters)
+    return;
+  for (unsigned i = 0; i < pending (); i++)
+    if (pending[i] == p)
+      {
+	pending.deletepart (i, 1);
+	break;
+      }
+  delete p;
+}
+
+void
+GroupCache::request (GroupCachePending * p, pth_event_t ev)
+{
+  if (p->sent)
+    return;
+  if (p->sending)
+    {
+      /* another waiter sends the read */
+      pth_mutex_acquire (&mutex, 0, 0);
+      pth_cond_await (&p->cond, &mutex, ev);
+      pth_mutex_release (&mutex);
+      return;
+    }
+  p->sending = true;
+  if (takeToken (ev))
+    {
+      sendRead (p->dst);
+      p->sent = true;
+    }
+  p->sending = false;
+  /* let another waiter try, if this one gave up */
+  if (!p->sent)
+    pth_cond_notify (&p->cond, 1);
+}
+
+GroupCacheRing **
+GroupCache::historyRing (eibaddr_t dst, unsigned &depth)
+{
+  for (unsigned i = 0; i < history (); i++)
+    if (dst >= history[i].start && dst <= history[i].end)
+      {
+	depth = history[i].depth;
+	return &history[i].ring[dst - history[i].start];
+      }
+  return 0;
+}
+
+void
+GroupCache::addHistory (eibaddr_t dst, eibaddr_t src, const uchar * data,
+			unsigned len, timestamp_t arrival)
+{
+  unsigned depth;
+  GroupCacheRing **r = historyRing (dst, depth);
+  if (!r)
+    return;
+  if (!*r)
+    {
+      *r = (GroupCacheRing *) malloc (sizeof (GroupCacheRing) +
+				      (depth -
+				       1) * sizeof (GroupCacheHistoryEntry));
+      if (!*r)
+	return;
+      (*r)->pos = 0;
+    }
+  GroupCacheHistoryEntry & e = (*r)->entry[(*r)->pos % depth];
+  e.time = arrival / 1000;
+  e.src = src;
+  e.len = len > 0xffff ? 0xffff : len;
+  memcpy (e.data, data, len < GROUPCACHE_INLINE ? len : GROUPCACHE_INLINE);
+  (*r)->pos++;
+}
+
+void
+GroupCache::clearHistory ()
+{
+  for (unsigned i = 0; i < history (); i++)
+    for (unsigned j = 0; j <= (unsigned) (history[i].end - history[i].start);
+	 j++)
+      if (history[i].ring[j])
+	{
+	  free (history[i].ring[j]);
+	  history[i].ring[j] = 0;
+	}
+}
+
+bool
+GroupCache::setHistory (eibaddr_t start, eibaddr_t end, unsigned depth)
+{
+  GroupCacheHistory h;
+  if (start > end || !depth)
+    return false;
+  TRACEPRINTF (t, 4, this, "GroupCacheHistory %d/%d/%d-%d/%d/%d %d",
+	       (start >> 11) & 0x1f, (start >> 8) & 0x07, (start) & 0xff,
+	       (end >> 11) & 0x1f, (end >> 8) & 0x07, (end) & 0xff, depth);
+  h.start = start;
+  h.end = end;
+  h.depth = depth;
+  h.ring = new GroupCacheRing *[end - start + 1];
+  memset (h.ring, 0, (end - start + 1) * sizeof (GroupCacheRing *));
+  history.add (h);
+  return true;
+}
+
+Array < GroupCacheHistoryEntry > GroupCache::History (eibaddr_t dst,
+						      uint64_t since)
+{
+  Array < GroupCacheHistoryEntry > a;
+  unsigned depth;
+  GroupCacheRing **r = historyRing (dst, depth);
+  if (!r || !*r)
+    return a;
+  uint32_t first = ((*r)->pos < depth ? 0 : (*r)->pos - depth);
+  for (uint32_t i = first; i < (*r)->pos; i++)
+    if ((*r)->entry[i % depth].time > since)
+      a.add ((*r)->entry[i % depth]);
+  return a;
+}
+
+void
+GroupCache::setReadRate (unsigned rate)
+{
+  readrate = rate;
+  tokens = rate;
+  tokentime = getMonotonicTime ();
+}
+
+bool
+GroupCache::takeToken (pth_event_t ev)
+{
+  bool delayed = false;
+  if (!readrate)
+    return true;
+  while (1)
+    {
+      timestamp_t now = getMonotonicTime ();
+      timestamp_t step = 1000000000LL / readrate;
+      timestamp_t n = (now - tokentime) / step;
+      if (n >= readrate - tokens)
+	{
+	  tokens = readrate;
+	  tokentime = now;
+	}
+      else if (n > 0)
+	{
+	  tokens += n;
+	  tokentime += n * step;
+	}
+      if (tokens)
+	{
+	  tokens--;
+	  return true;
+	}
+      if (!delayed)
+	{
+	  limited.inc ();
+	  delayed = true;
+	}
+
+      timestamp_t wait = tokentime + step - now;
+      pth_event_t timeout = pth_event (PTH_EVENT_RTIME,
+				       pth_time (wait / 1000000000LL,
+						 (wait % 1000000000LL) /
+						 1000));
+      pth_event_concat (timeout, ev, NULL);
+      pth_wait (timeout);
+      pth_event_isolate (timeout);
+      bool expired = pth_event_status (timeout) == PTH_STATUS_OCCURRED;
+      pth_event_free (timeout, PTH_FREE_THIS);
+      if (!expired)
+	return false;
+    }
+}
+
+void
+GroupCache::sendRead (eibaddr_t addr)
+{
+  A_GroupValue_Read_PDU apdu;
+  T_DATA_XXX_REQ_PDU tpdu;
+  L_Data_PDU *l;
+
+  tpdu.data = apdu.ToPacket ();
+  l = new L_Data_PDU;
+  l->data = tpdu.ToPacket ();
+  l->source = 0;
+  l->dest = addr;
+  l->AddrType = GroupAddress;
+  l->object = this;
+  layer3->send_L_Data (l);
+}
+
+void
+GroupCache::setProxy (unsigned age)
+{
+  if (!age && proxyage)
+    layer3->setResponder (0);
+  if (age && !proxyage)
+    layer3->setResponder (this);
+  proxyage = age;
+}
+
+bool
+GroupCache::Respond (L_Data_PDU * l, L_Data_PDU * &answer)
+{
+  APDU_View a;
+  unsigned i;
+  if (!enable || l->data () < 2 || (l->data[0] & 0xfc) != 0
+      || !a.init (l->data) || a.type != A_GroupValue_Read)
+    return false;
+
+  timestamp_t now = getMonotonicTime ();
+  if (l->object != this)
+    {
+      const GroupCacheSlot *s = Get (l->dest, proxyage);
+      /* entries of failed reads have no value */
+      if (s && s->len >= 2)
+	{
+	  TRACEPRINTF (t, 4, this, "GroupCacheAnswer %d/%d/%d",
+		       (l->dest >> 11) & 0x1f, (l->dest >> 8) & 0x07,
+		       (l->dest) & 0xff);
+	  answer = new L_Data_PDU;
+	  answer->source = s->src;
+	  answer->dest = l->dest;
+	  answer->AddrType = GroupAddress;
+	  answer->data.set (value (s), s->len);
+	  /* the cache holds A_GroupValue_Write or A_GroupValue_Response */
+	  answer->data[1] = (answer->data[1] & 0x3f) | 0x40;
+	  answer->object = this;
+	  answered.inc ();
+	  return true;
+	}
+      for (i = 0; i < GROUPCACHE_RECENTREADS; i++)
+	if (recent[i].dst == l->dest && now - recent[i].time < 1000000000LL)
+	  {
+	    suppressed.inc ();
+	    return true;
+	  }
+    }
+  recent[recentpos].dst = l->dest;
+  recent[recentpos].time = now;
+  recentpos = (recentpos + 1) % GROUPCACHE_RECENTREADS;
+  return false;
+}
+
+const GroupCacheSlot *
+GroupCache::Get (eibaddr_t addr, uint16_t age)
+{
+  GroupCacheSlot *c;
+  if (!enable)
+    return 0;
+  c = find (addr);
+  if (c && age && c->recvtime + age < time (0))
+    return 0;
+  return c;
+}
+
+int
+GroupCache::Next (unsigned addr)
+{
+  while (addr < 0x10000)
+    {
+      uint32_t w = present[addr >> 5] >> (addr & 0x1f);
+      if (w)
+	return addr + __builtin_ctz (w);
+      addr = (addr | 0x1f) + 1;
+    }
+  return -1;
+}
+
+void
+GroupCache::Fetch (const Array < eibaddr_t > &addrs, uint16_t age,
+		   unsigned Timeout, pth_event_t stop)
+{
+  Array < GroupCachePending * >wait;
+  unsigned i, missing;
+  if (!enable)
+    return;
+  for (i = 0; i < addrs (); i++)
+    if (!Get (addrs[i], age))
+      wait.add (attach (addrs[i]));
+  if (!wait ())
+    return;
+  TRACEPRINTF (t, 4, this, "GroupCacheFetch %d", wait ());
+
+  pth_event_t timeout = pth_event (PTH_EVENT_RTIME, pth_time (Timeout, 0));
+  pth_event_concat (timeout, stop, NULL);
+  for (i = 0; i < wait (); i++)
+    if (!wait[i]->sent && !wait[i]->sending)
+      {
+	request (wait[i], timeout);
+	if (!wait[i]->sent)
+	  break;
+      }
+  missing = wait ();
+  while (missing && pth_event_status (timeout) != PTH_STATUS_OCCURRED
+	 && pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
+      WaitChange (logpos, timeout);
+      missing = 0;
+      for (i = 0; i < wait (); i++)
+	if (!Get (wait[i]->dst, age))
+	  missing++;
+    }
+  pth_event_isolate (timeout);
+  pth_event_free (timeout, PTH_FREE_THIS);
+  for (i = 0; i < wait (); i++)
+    detach (wait[i]);
+}
+
 Array < eibaddr_t > GroupCache::LastUpdates (uint16_t start, uint8_t Timeout,
 					     uint16_t & end, pth_event_t stop)
 {
   Array < eibaddr_t > a;
   pth_event_t timeout = pth_event (PTH_EVENT_RTIME, pth_time (Timeout, 0));
+  /* the positions of the clients are the lower 16 bit of the sequence */
+  unsigned window = (logsize < 0xffff ? logsize : 0xffff);
 
   do
     {
-      if (pos < 0x100)
-	{
-	  if (pos < start && start < ((pos - 0x100) & 0xffff))
-	    start = (pos - 0x100) & 0xffff;
-	}
-      else
+      uint32_t first = (logpos < window ? 0 : logpos - window);
+      uint32_t cursor = logpos - (uint16_t) (logpos - start);
+      if (cursor < first)
+	cursor = first;
+      TRACEPRINTF (t, 8, this, "LastUpdates start: %d pos: %d", start,
+		   logpos & 0xffff);
+      if (cursor != logpos
+	  || pth_event_status (timeout) == PTH_STATUS_OCCURRED)
 	{
-	  if (start < ((pos - 0x100) & 0xffff) || start > pos)
-	    start = (pos - 0x100) & 0xffff;
-	}
-      TRACEPRINTF (t, 8, this, "LastUpdates start: %d pos: %d", start, pos);
-      while (start != pos && !updates[start & 0xff])
-	start++;
-      if (start != pos)
-	{
-	  while (start != pos)
-	    {
-	      if (updates[start & 0xff])
-		{
-		  a.resize (a () + 1);
-		  a[a () - 1] = updates[start & 0xff];
-		}
-	      start++;
-	    }
-	  end = pos;
+	  a.resize (logpos - cursor);
+	  for (unsigned i = 0; cursor != logpos; cursor++)
+	    a[i++] = log[cursor % logsize].dst;
+	  end = logpos & 0xffff;
 	  pth_event_free (timeout, PTH_FREE_THIS);
 	  return a;
 	}
-      if (pth_event_status (timeout) == PTH_STATUS_OCCURRED)
+      pth_event_concat (timeout, stop, NULL);
+      WaitChange (cursor, timeout);
+      pth_event_isolate (timeout);
+      if (pth_event_status (stop) == PTH_STATUS_OCCURRED)
 	{
-	  end = pos;
+	  end = logpos & 0xffff;
 	  pth_event_free (timeout, PTH_FREE_THIS);
 	  return a;
 	}
+    }
+  while (1);
+}
+
+Array < GroupCacheChange > GroupCache::Changes (uint32_t & cursor,
+						unsigned max, uint32_t & lost)
+{
+  Array < GroupCacheChange > a;
+  uint32_t first = (logpos < logsize ? 0 : logpos - logsize);
+  lost = 0;
+  if (logpos - cursor > logpos - first)
+    {
+      lost = first - cursor;
+      /* a cursor in the future is reset without loss */
+      if (lost > logpos)
+	lost = 0;
+      cursor = first;
+    }
+  if (logpos - cursor < max)
+    max = logpos - cursor;
+  a.resize (max);
+  for (unsigned i = 0; i < max; i++)
+    a[i] = log[(cursor + i) % logsize];
+  cursor += max;
+  return a;
+}
+
+bool
+GroupCache::WaitChange (uint32_t cursor, pth_event_t ev)
+{
+  if (cursor != logpos)
+    return true;
+  pth_mutex_acquire (&mutex, 0, 0);
+  pth_cond_await (&cond, &mutex, ev);
+  pth_mutex_release (&mutex);
+  return cursor != logpos;
+}
+
+/** stores v as big endian number of len bytes at p */
+static void
+putnum (uchar * p, uint64_t v, int len)
+{
+  while (len-- > 0)
+    {
+      p[len] = v & 0xff;
+      v >>= 8;
+    }
+}
+
+/** reads a big endian number of len bytes from p */
+static uint64_t
+getnum (const uchar * p, int len)
+{
+  uint64_t v = 0;
+  for (int i = 0; i < len; i++)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+CArray
+GroupCache::Snapshot ()
+{
+  CArray a;
+  unsigned i, pos, len;
+
+  a.resize (GROUPCACHE_SNAPSHOT_HEADER);
+  memcpy (a.array (), GROUPCACHE_SNAPSHOT_MAGIC, 8);
+  putnum (a.array () + 8, GROUPCACHE_SNAPSHOT_VERSION, 2);
+  putnum (a.array () + 10, 0, 2);
+  putnum (a.array () + 12, count, 4);
+  for (i = 0; i < 0x10000; i++)
+    {
+      const GroupCacheSlot *s = find (i);
+      if (!s)
+	continue;
+      pos = a ();
+      len = GROUPCACHE_SNAPSHOT_RECORD + ((s->len + 7) & ~7);
+      a.resize (pos + len);
+      memset (a.array () + pos, 0, len);
+      uchar *h = a.array () + pos;
+      putnum (h, i, 2);
+      putnum (h + 2, s->src, 2);
+      putnum (h + 4, s->len, 2);
+      putnum (h + 8, s->recvtime, 8);
+      memcpy (h + GROUPCACHE_SNAPSHOT_RECORD,
+	      s->len > GROUPCACHE_INLINE ? s->ext : s->data, s->len);
+    }
+  return a;
+}
+
+/** writes a snapshot to file, replacing it atomically; blocks the whole process */
+static bool
+writeSnapshot (const char *file, const CArray & a)
+{
+  String tmp = String (file) + ".tmp";
+  unsigned pos = 0;
+  int fd, i;
+
+  fd = open (tmp (), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    return false;
+  while (pos < a ())
+    {
+      i = write (fd, a.array () + pos, a () - pos);
+      if (i == -1 && errno == EINTR)
+	continue;
+      if (i <= 0)
+	break;
+      pos += i;
+    }
+  if (pos < a () || fsync (fd))
+    {
+      close (fd);
+      unlink (tmp ());
+      return false;
+    }
+  close (fd);
+  if (rename (tmp (), file))
+    {
+      unlink (tmp ());
+      return false;
+    }
+  return true;
+}
+
+bool
+GroupCache::Save (const char *file)
+{
+  TRACEPRINTF (t, 4, this, "GroupCacheSave %s", file);
+  if (!writeSnapshot (file, Snapshot ()))
+    return false;
+  dirty = false;
+  return true;
+}
+
+bool
+GroupCache::Load (const char *file)
+{
+  struct stat st;
+  const uchar *m;
+  unsigned off, i, n;
+  time_t recvtime;
+  int fd;
+
+  TRACEPRINTF (t, 4, this, "GroupCacheLoad %s", file);
+  fd = open (file, O_RDONLY);
+  if (fd == -1)
+    return false;
+  if (fstat (fd, &st) || st.st_size < GROUPCACHE_SNAPSHOT_HEADER)
+    {
+      close (fd);
+      return false;
+    }
+  m = (const uchar *) mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (m == MAP_FAILED)
+    return false;
+  if (memcmp (m, GROUPCACHE_SNAPSHOT_MAGIC, 8)
+      || getnum (m + 8, 2) != GROUPCACHE_SNAPSHOT_VERSION)
+    {
+      munmap ((void *) m, st.st_size);
+      return false;
+    }
+  n = getnum (m + 12, 4);
+  off = GROUPCACHE_SNAPSHOT_HEADER;
+  for (i = 0; i < n; i++)
+    {
+      if ((off_t) (off + GROUPCACHE_SNAPSHOT_RECORD) > st.st_size)
+	break;
+      const uchar *r = m + off;
+      unsigned len = getnum (r + 4, 2);
+      off += GROUPCACHE_SNAPSHOT_RECORD;
+      if ((off_t) (off + len) > st.st_size)
+	break;
+      recvtime = getnum (r + 8, 8);
+      add (getnum (r, 2), getnum (r + 2, 2), m + off, len)->recvtime =
+	recvtime;
+      off += (len + 7) & ~7;
+    }
+  munmap ((void *) m, st.st_size);
+  TRACEPRINTF (t, 4, this, "GroupCacheLoad %d entries", i);
+  dirty = false;
+  return i == n;
+}
+
+void
+GroupCache::setSnapshot (const char *file, unsigned interval)
+{
+  if (saver)
+    delete saver;
+  saver = new GroupCacheSaver (this, file, interval);
+}
+
+GroupCacheSaver::GroupCacheSaver (GroupCache * c, const char *f,
+				  unsigned i)
+{
+  cache = c;
+  file = f;
+  interval = i;
+  Start ();
+}
+
+GroupCacheSaver::~GroupCacheSaver ()
+{
+  Stop ();
+  if (cache->dirty && !cache->Save (file ()))
+    ERRORPRINTF (cache->t, 0x24000001, cache,
+		 "can't write group cache snapshot %s", file ());
+}
+
+bool
+GroupCacheSaver::Save ()
+{
+  int status;
+  pid_t pid;
+
+  TRACEPRINTF (cache->t, 4, cache, "GroupCacheSave %s", file ());
+  CArray a = cache->Snapshot ();
+  cache->dirty = false;
+  /* fsync would stall all threads, so a child process writes the file */
+  pid = fork ();
+  if (pid == -1)
+    {
+      cache->dirty = true;
+      return false;
+    }
+  if (!pid)
+    _exit (writeSnapshot (file (), a) ? 0 : 1);
+  if (pth_waitpid (pid, &status, 0) == -1 || !WIFEXITED (status)
+      || WEXITSTATUS (status))
+    {
+      cache->dirty = true;
+      return false;
+    }
+  return true;
+}
+
+void
+GroupCacheSaver::Run (pth_sem_t * stop1)
+{
+  pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  pth_event_t timeout = pth_event (PTH_EVENT_RTIME, pth_time (interval, 0));
+  while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
       pth_event_concat (timeout, stop, NULL);
-      pth_mutex_acquire (&mutex, 0, 0);
-      pth_cond_await (&cond, &mutex, timeout);
-      pth_mutex_release (&mutex);
+      pth_wait (timeout);
       pth_event_isolate (timeout);
+      if (pth_event_status (timeout) != PTH_STATUS_OCCURRED)
+	continue;
+      if (cache->dirty && !Save ())
+	ERRORPRINTF (cache->t, 0x24000001, cache,
+		 "can't write group cache snapshot %s", file ());
+      pth_event (PTH_EVENT_RTIME | PTH_MODE_REUSE, timeout,
+		 pth_time (interval, 0));
     }
-  while (1);
+  pth_event_free (timeout, PTH_FREE_THIS);
+  pth_event_free (stop, PTH_FREE_THIS);
 }
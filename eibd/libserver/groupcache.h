@@ -36,28 +36,250 @@ typedef struct
   time_t recvtime;
 } GroupCacheEntry;
 
-class GroupCache:public L_Data_CallBack
+/* Format of the group cache snapshot file
+ *
+ * All numbers are stored in network byte order. The file starts with
+ * a header:
+ *  - magic (8 bytes)
+ *  - version (2 bytes)
+ *  - reserved (2 bytes)
+ *  - number of records (4 bytes)
+ * Each record starts at a multiple of 8 bytes and consists of:
+ *  - group address (2 bytes)
+ *  - source address (2 bytes)
+ *  - value length (2 bytes)
+ *  - reserved (2 bytes)
+ *  - receive time in seconds since the epoch (8 bytes)
+ *  - value, padded with zeros to a multiple of 8 bytes
+ */
+#define GROUPCACHE_SNAPSHOT_MAGIC "EIBCACHE"
+#define GROUPCACHE_SNAPSHOT_VERSION 1
+#define GROUPCACHE_SNAPSHOT_HEADER 16
+#define GROUPCACHE_SNAPSHOT_RECORD 16
+
+/** size of the value storage inside a cache slot */
+#define GROUPCACHE_INLINE 14
+
+/** cached value of one group address */
+typedef struct
+{
+  /** source address */
+  eibaddr_t src;
+  /** length of the value */
+  uint16_t len;
+  /** size of ext */
+  uint16_t extlen;
+  /** receive time */
+  time_t recvtime;
+  /** value, if it fits */
+  uchar data[GROUPCACHE_INLINE];
+  /** value, if it is longer than GROUPCACHE_INLINE; kept for reuse */
+  uchar *ext;
+} GroupCacheSlot;
+
+/** entry of the change log */
+typedef struct
+{
+  /** group address */
+  eibaddr_t dst;
+  /** source address */
+  eibaddr_t src;
+  /** receive time */
+  time_t recvtime;
+  /** length of the value */
+  uint16_t len;
+  /** value; longer values are truncated, the full value is in the cache */
+  uchar data[GROUPCACHE_INLINE];
+} GroupCacheChange;
+
+/** default number of entries of the change log */
+#define GROUPCACHE_LOGSIZE 4096
+
+/** cache slots of 256 consecutive group addresses */
+typedef struct
+{
+  GroupCacheSlot slot[0x100];
+} GroupCachePage;
+
+/** value in the history of a group address */
+typedef struct
+{
+  /** receive time (monotonic clock, in us) */
+  uint64_t time;
+  /** source address */
+  eibaddr_t src;
+  /** length of the value */
+  uint16_t len;
+  /** value; longer values are truncated */
+  uchar data[GROUPCACHE_INLINE];
+} GroupCacheHistoryEntry;
+
+/** history of one group address, allocated as one block */
+typedef struct
+{
+  /** number of values stored so far; value n is at entry[n % depth] */
+  uint32_t pos;
+  /** values, depth entries */
+  GroupCacheHistoryEntry entry[1];
+} GroupCacheRing;
+
+/** history configuration of a range of group addresses */
+typedef struct
+{
+  /** first group address */
+  eibaddr_t start;
+  /** last group address */
+  eibaddr_t end;
+  /** number of values kept per group address */
+  unsigned depth;
+  /** history of start + i, allocated with the first value */
+  GroupCacheRing **ring;
+} GroupCacheHistory;
+
+/** a GroupValue_Read in progress */
+typedef struct
+{
+  /** group address */
+  eibaddr_t dst;
+  /** number of readers waiting for the answer */
+  unsigned waiters;
+  /** the GroupValue_Read was sent */
+  bool sent;
+  /** a reader waits for a token to send the GroupValue_Read */
+  bool sending;
+  /** signaled, when a value for dst arrives */
+  pth_cond_t cond;
+} GroupCachePending;
+
+/** GroupValue_Read recently sent to the bus */
+typedef struct
+{
+  /** group address */
+  eibaddr_t dst;
+  /** send time */
+  timestamp_t time;
+} GroupCacheRecentRead;
+
+/** number of recent GroupValue_Read remembered to coalesce reads of
+ * clients */
+#define GROUPCACHE_RECENTREADS 64
+
+/** default number of GroupValue_Read sent for cache misses per second */
+#define GROUPCACHE_READRATE 20
+
+class GroupCacheSaver;
+
+class GroupCache:public L_Data_CallBack, public L_Data_Responder
 {
   /** Layer 3 interface */
   Layer3 *layer3;
   /** debug output */
   Trace *t;
-  /** output queue */
-    Array < GroupCacheEntry * >cache;
+  /** cache slots, indexed by the high byte of the group address;
+   * pages are allocated on first use and kept until destruction */
+  GroupCachePage *pages[0x100];
+  /** bitmap of the group addresses with a cached value */
+  uint32_t present[0x10000 / 32];
+  /** number of cached group addresses */
+  unsigned count;
   bool enable;
   pth_mutex_t mutex;
   pth_cond_t cond;
-  uint16_t pos;
-  eibaddr_t updates[0x100];
+  /** ring of the last changes */
+  GroupCacheChange *log;
+  /** number of entries of log, a power of 2 */
+  unsigned logsize;
+  /** sequence number of the next change; the change n is stored
+   * at log[n % logsize] */
+  uint32_t logpos;
+  /** reads answered from the cache */
+  Counter hits;
+  /** reads not answered from the cache */
+  Counter misses;
+  /** received values */
+  Counter updated;
+  /** reads attached to a GroupValue_Read of another reader */
+  Counter coalesced;
+  /** reads delayed by the rate limit */
+  Counter limited;
+  /** reads of clients answered from the cache */
+  Counter answered;
+  /** reads of clients dropped, as the same read was just sent */
+  Counter suppressed;
+  /** number of cached addresses */
+  Gauge entries;
+
+  /** returns the slot of dst, if it has a value, else 0 */
+  GroupCacheSlot *find (eibaddr_t dst)
+  {
+    if (!(present[dst >> 5] & (1U << (dst & 0x1f))))
+      return 0;
+    return &pages[dst >> 8]->slot[dst & 0xff];
+  }
+  /** stores a value for dst */
+  GroupCacheSlot *add (eibaddr_t dst, eibaddr_t src, const uchar * data,
+		       unsigned len);
+  /** copies the value of dst out of s */
+  static GroupCacheEntry entry (eibaddr_t dst, const GroupCacheSlot * s);
+  /** sends a GroupValue_Read for addr */
+  void sendRead (eibaddr_t addr);
+
+  /** group address ranges with history */
+    Array < GroupCacheHistory > history;
+  /** returns the history slot of dst and its depth, 0 if dst
+   * has no history */
+  GroupCacheRing **historyRing (eibaddr_t dst, unsigned &depth);
+  /** appends a value received at arrival (getMonotonicTime) to the
+   * history of dst */
+  void addHistory (eibaddr_t dst, eibaddr_t src, const uchar * data,
+		   unsigned len, timestamp_t arrival);
+  /** frees the history of all addresses */
+  void clearHistory ();
+
+  /** GroupValue_Read in progress */
+    Array < GroupCachePending * >pending;
+  /** GroupValue_Read allowed per second, 0 for no limit */
+  unsigned readrate;
+  /** GroupValue_Read, which may be sent at once */
+  unsigned tokens;
+  /** time of the last token refill */
+  timestamp_t tokentime;
+  /** maximum age of the values answered to clients, 0 if disabled */
+  unsigned proxyage;
+  /** GroupValue_Read recently sent to the bus, a ring */
+  GroupCacheRecentRead recent[GROUPCACHE_RECENTREADS];
+  /** next entry of recent to overwrite */
+  unsigned recentpos;
+
+  /** returns the pending read of dst and registers the caller as
+   * waiter, creates it, if necessary */
+  GroupCachePending *attach (eibaddr_t dst);
+  /** unregisters a waiter of p; frees p with the last one */
+  void detach (GroupCachePending * p);
+  /** sends the GroupValue_Read of p, if no other waiter does so,
+   * as soon as the rate limit allows it or until ev occurs */
+  void request (GroupCachePending * p, pth_event_t ev);
+  /** takes a token of the rate limit; waits until ev occurs
+   * @return false, if no token is available */
+  bool takeToken (pth_event_t ev);
 
-  GroupCacheEntry *find (eibaddr_t dst);
-  void add (GroupCacheEntry * entry);
+  friend class GroupCacheSaver;
+  /** writes the snapshots */
+  GroupCacheSaver *saver;
+  /** the content changed since the last snapshot */
+  bool dirty;
 
 public:
-    GroupCache (Layer3 * l3, Trace * t);
+  /** creates the cache
+   * @param logsize number of changes kept for LastUpdates and Changes,
+   * rounded up to a power of 2
+   */
+    GroupCache (Layer3 * l3, Trace * t, unsigned logsize =
+		GROUPCACHE_LOGSIZE);
     virtual ~ GroupCache ();
 
   void Get_L_Data (L_Data_PDU * l);
+  bool Respond (L_Data_PDU * l, L_Data_PDU * &answer);
 
   bool Start ();
   void Clear ();
@@ -66,7 +288,86 @@ public:
   GroupCacheEntry Read (eibaddr_t addr, unsigned timeout, uint16_t age);
     Array < eibaddr_t > LastUpdates (uint16_t start, uint8_t timeout,
 				     uint16_t & end, pth_event_t stop);
+  /** returns the position of the next change */
+  uint32_t ChangePos () const
+  {
+    return logpos;
+  }
+  /** returns up to max changes from cursor on
+   * @param cursor position in the change log, advanced behind the
+   * returned changes
+   * @param lost number of changes, which were overwritten before
+   * they were read
+   */
+    Array < GroupCacheChange > Changes (uint32_t & cursor, unsigned max,
+					uint32_t & lost);
+  /** returns the slot of addr, if it has a value not older than age
+   * seconds (0 accepts any age), else 0 */
+  const GroupCacheSlot *Get (eibaddr_t addr, uint16_t age);
+  /** returns the first address >= addr with a value, or -1 */
+  int Next (unsigned addr);
+  /** returns the value stored in s */
+  static const uchar *value (const GroupCacheSlot * s)
+  {
+    return s->len > GROUPCACHE_INLINE ? s->ext : s->data;
+  }
+  /** reads all addresses of addrs without a value not older than age
+   * from the bus at once, as far as the rate limit allows, and waits up
+   * to timeout seconds for the answers; aborts if stop occurs */
+  void Fetch (const Array < eibaddr_t > &addrs, uint16_t age,
+	      unsigned timeout, pth_event_t stop);
+  /** waits until there is a change after cursor or ev occurs
+   * @return true, if there is a change
+   */
+  bool WaitChange (uint32_t cursor, pth_event_t ev);
   void remove (eibaddr_t addr);
+
+  /** returns the content of a snapshot file with all cached values */
+  CArray Snapshot ();
+  /** writes all cached values to file
+   * @return true, if successful */
+  bool Save (const char *file);
+  /** adds the values of a snapshot file to the cache
+   * @return true, if successful */
+  bool Load (const char *file);
+  /** saves the cache to file every interval seconds, if it changed,
+   * and on destruction */
+  void setSnapshot (const char *file, unsigned interval);
+  /** keeps the last depth values of the group addresses start to end;
+   * for overlapping ranges, the first one counts
+   * @return false, if the range is invalid */
+  bool setHistory (eibaddr_t start, eibaddr_t end, unsigned depth);
+  /** returns the values of dst received after since (in us of the
+   * monotonic clock), oldest first */
+    Array < GroupCacheHistoryEntry > History (eibaddr_t dst,
+					      uint64_t since);
+  /** answers GroupValue_Read of clients with the cached value, if it
+   * is not older than age seconds, and drops reads of clients, which
+   * were just sent to the bus; 0 disables it */
+  void setProxy (unsigned age);
+  /** limits the GroupValue_Read sent for cache misses to rate per
+   * second, 0 disables the limit */
+  void setReadRate (unsigned rate);
+};
+
+/** writes periodic snapshots of a group cache */
+class GroupCacheSaver:private Thread
+{
+  /** group cache */
+  GroupCache *cache;
+  /** snapshot file */
+  String file;
+  /** seconds between two snapshots */
+  unsigned interval;
+
+  void Run (pth_sem_t * stop);
+  /** writes a snapshot without blocking the other threads
+   * @return true, if successful */
+  bool Save ();
+public:
+    GroupCacheSaver (GroupCache * cache, const char *file,
+		     unsigned interval);
+    virtual ~ GroupCacheSaver ();
 };
 
 #endif
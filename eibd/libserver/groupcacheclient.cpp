@@ -17,19 +17,146 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <stdio.h>
 #include "groupcacheclient.h"
 #include "groupcache.h"
 #include "client.h"
 
 static GroupCache *cache = 0;
 
+/** maximum size of the records in one EIB_CACHE_SCAN answer */
+#define SCAN_CHUNK 4096
+
+/** appends the value s of dst as record to erg:
+ * dst (2 bytes), src (2 bytes), age (2 bytes), length (1 byte), value
+ * @return false, if the record does not fit into max bytes */
+static bool
+putRecord (CArray & erg, unsigned max, eibaddr_t dst,
+	   const GroupCacheSlot * s, time_t now)
+{
+  unsigned pos = erg ();
+  unsigned len = s->len > 0xff ? 0xff : s->len;
+  time_t d = now - s->recvtime;
+  if (pos + 7 + len > max)
+    return false;
+  if (d < 0)
+    d = 0;
+  if (d > 0xffff)
+    d = 0xffff;
+  erg.resize (pos + 7);
+  erg[pos] = (dst >> 8) & 0xff;
+  erg[pos + 1] = (dst) & 0xff;
+  erg[pos + 2] = (s->src >> 8) & 0xff;
+  erg[pos + 3] = (s->src) & 0xff;
+  erg[pos + 4] = (d >> 8) & 0xff;
+  erg[pos + 5] = (d) & 0xff;
+  erg[pos + 6] = len;
+  erg.setpart (GroupCache::value (s), pos + 7, len);
+  return true;
+}
+
+/** streams the values of the group addresses lo to hi in address
+ * order as EIB_CACHE_SCAN answers of up to SCAN_CHUNK bytes; a
+ * snapshot copies all values first, so that they are consistent */
+static void
+scan (ClientConnection * c, eibaddr_t lo, eibaddr_t hi, bool snapshot,
+      pth_event_t stop)
+{
+  CArray erg, copy;
+  unsigned pos = 0;
+  int a = lo;
+  time_t now = time (0);
+
+  if (snapshot)
+    {
+      for (; (a = cache->Next (a)) != -1 && a <= hi; a++)
+	{
+	  const GroupCacheSlot *s = cache->Get (a, 0);
+	  if (s && (s->src || s->len))
+	    putRecord (copy, 0xffffffff, a, s, now);
+	}
+    }
+
+  do
+    {
+      erg.resize (3);
+      EIBSETTYPE (erg, EIB_CACHE_SCAN);
+      erg[2] = 0;
+      if (snapshot)
+	{
+	  /* split the copy at record boundaries */
+	  while (pos < copy () && erg () + 7 + copy[pos + 6] <= SCAN_CHUNK)
+	    {
+	      unsigned len = 7 + copy[pos + 6];
+	      erg.setpart (copy.array () + pos, erg (), len);
+	      pos += len;
+	    }
+	  if (pos == copy ())
+	    erg[2] = EIB_CACHE_SCAN_LAST;
+	}
+      else
+	{
+	  now = time (0);
+	  for (; (a = cache->Next (a)) != -1 && a <= hi; a++)
+	    {
+	      const GroupCacheSlot *s = cache->Get (a, 0);
+	      /* skip entries of failed reads */
+	      if (!s || (!s->src && !s->len))
+		continue;
+	      if (!putRecord (erg, SCAN_CHUNK, a, s, now))
+		break;
+	    }
+	  if (a == -1 || a > hi)
+	    erg[2] = EIB_CACHE_SCAN_LAST;
+	}
+      if (c->sendmessage (erg (), erg.array (), stop) == -1)
+	return;
+    }
+  while (!(erg[2] & EIB_CACHE_SCAN_LAST));
+}
+
 bool
-CreateGroupCache (Layer3 * l3, Trace * t, bool enable)
+CreateGroupCache (Layer3 * l3, Trace * t, bool enable, const char *snapshot,
+		  unsigned interval, unsigned logsize, unsigned readrate,
+		  const char *history, unsigned proxyage)
 {
-  cache = new GroupCache (l3, t);
+  cache = new GroupCache (l3, t, logsize ? logsize : GROUPCACHE_LOGSIZE);
+  cache->setReadRate (readrate);
+  while (history && *history)
+    {
+      unsigned depth, a, b, c, d, e, f;
+      int n = 0;
+      eibaddr_t start = 0, end = 0xffff;
+      if (sscanf (history, "%u:%u/%u/%u-%u/%u/%u%n", &depth, &a, &b, &c, &d,
+		  &e, &f, &n) == 7 && n)
+	{
+	  start = ((a & 0x1f) << 11) | ((b & 0x07) << 8) | (c & 0xff);
+	  end = ((d & 0x1f) << 11) | ((e & 0x07) << 8) | (f & 0xff);
+	}
+      else if (sscanf (history, "%u:%u/%u/%u%n", &depth, &a, &b, &c, &n) ==
+	       4 && n)
+	start = end = ((a & 0x1f) << 11) | ((b & 0x07) << 8) | (c & 0xff);
+      else if (sscanf (history, "%u%n", &depth, &n) != 1 || !n)
+	return false;
+      if (!cache->setHistory (start, end, depth))
+	return false;
+      history += n;
+      if (*history == ',')
+	history++;
+      else if (*history)
+	return false;
+    }
+  if (snapshot)
+    {
+      if (!cache->Load (snapshot))
+	TRACEPRINTF (t, 4, cache, "no valid group cache snapshot %s",
+		     snapshot);
+      cache->setSnapshot (snapshot, interval);
+    }
   if (enable)
     if (!cache->Start ())
       return false;
+  cache->setProxy (proxyage);
   return true;
 }
 
@@ -135,7 +262,247 @@ GroupCacheRequest (Layer3 * l3, Trace * t, ClientConnection * c,
       }
       break;
 
+    case EIB_CACHE_CHANGES:
+      if (c->size < 3)
+	{
+	  c->sendreject (stop);
+	  return;
+	}
+      {
+	uint32_t lost;
+	pth_event_t timeout =
+	  pth_event (PTH_EVENT_RTIME, pth_time (c->buf[2], 0));
+	if (!c->cachecursorvalid)
+	  {
+	    c->cachecursor = cache->ChangePos ();
+	    c->cachecursorvalid = true;
+	  }
+	pth_event_concat (timeout, stop, NULL);
+	cache->WaitChange (c->cachecursor, timeout);
+	pth_event_isolate (timeout);
+	pth_event_free (timeout, PTH_FREE_THIS);
+	Array < GroupCacheChange > changes =
+	  cache->Changes (c->cachecursor, (0xffff - 6) / 2, lost);
+	erg.resize (changes () * 2 + 6);
+	EIBSETTYPE (erg, EIBTYPE (c->buf));
+	erg[2] = (lost >> 24) & 0xff;
+	erg[3] = (lost >> 16) & 0xff;
+	erg[4] = (lost >> 8) & 0xff;
+	erg[5] = (lost) & 0xff;
+	for (unsigned i = 0; i < changes (); i++)
+	  {
+	    erg[6 + i * 2] = (changes[i].dst >> 8) & 0xff;
+	    erg[6 + i * 2 + 1] = (changes[i].dst) & 0xff;
+	  }
+	c->sendmessage (erg (), erg.array (), stop);
+      }
+      break;
+
+    case EIB_CACHE_READ_MULTI:
+      if (c->size < 5 || (c->size - 5) % 4)
+	{
+	  c->sendreject (stop);
+	  return;
+	}
+      {
+	uint8_t flags = c->buf[2];
+	unsigned i;
+	time_t now;
+	age = (c->buf[3] << 8) | (c->buf[4]);
+	if (flags & EIB_CACHE_READ_MULTI_FETCH)
+	  {
+	    /* only single addresses are read from the bus */
+	    Array < eibaddr_t > fetch;
+	    for (i = 5; i < c->size; i += 4)
+	      if (c->buf[i] == c->buf[i + 2] && c->buf[i + 1] == c->buf[i + 3])
+		fetch.add ((c->buf[i] << 8) | (c->buf[i + 1]));
+	    cache->Fetch (fetch, age, 1, stop);
+	  }
+	now = time (0);
+	erg.resize (3);
+	EIBSETTYPE (erg, EIBTYPE (c->buf));
+	erg[2] = 0;
+	for (i = 5; i < c->size && !erg[2]; i += 4)
+	  {
+	    int a = (c->buf[i] << 8) | (c->buf[i + 1]);
+	    int end = (c->buf[i + 2] << 8) | (c->buf[i + 3]);
+	    for (; (a = cache->Next (a)) != -1 && a <= end; a++)
+	      {
+		const GroupCacheSlot *s = cache->Get (a, age);
+		/* skip entries of failed reads */
+		if (!s || (!s->src && !s->len))
+		  continue;
+		if (!putRecord (erg, 0xffff, a, s, now))
+		  {
+		    erg[2] |= EIB_CACHE_READ_MULTI_TRUNCATED;
+		    break;
+		  }
+	      }
+	  }
+	c->sendmessage (erg (), erg.array (), stop);
+      }
+      break;
+
+    case EIB_CACHE_HISTORY:
+      if (c->size < 10 || (c->size - 10) % 2)
+	{
+	  c->sendreject (stop);
+	  return;
+	}
+      {
+	uint64_t since = 0;
+	uint64_t now = getMonotonicTime () / 1000;
+	unsigned i, j;
+	for (i = 2; i < 10; i++)
+	  since = (since << 8) | c->buf[i];
+	erg.resize (11);
+	EIBSETTYPE (erg, EIBTYPE (c->buf));
+	erg[2] = 0;
+	for (i = 0; i < 8; i++)
+	  erg[3 + i] = (now >> (56 - 8 * i)) & 0xff;
+	for (i = 10; i < c->size && !erg[2]; i += 2)
+	  {
+	    dst = (c->buf[i] << 8) | (c->buf[i + 1]);
+	    Array < GroupCacheHistoryEntry > h = cache->History (dst, since);
+	    for (j = 0; j < h (); j++)
+	      {
+		unsigned pos = erg ();
+		unsigned len =
+		  h[j].len < GROUPCACHE_INLINE ? h[j].len : GROUPCACHE_INLINE;
+		if (pos + 14 + len > 0xffff)
+		  {
+		    erg[2] |= EIB_CACHE_HISTORY_TRUNCATED;
+		    break;
+		  }
+		erg.resize (pos + 14);
+		erg[pos] = (dst >> 8) & 0xff;
+		erg[pos + 1] = (dst) & 0xff;
+		erg[pos + 2] = (h[j].src >> 8) & 0xff;
+		erg[pos + 3] = (h[j].src) & 0xff;
+		for (unsigned k = 0; k < 8; k++)
+		  erg[pos + 4 + k] = (h[j].time >> (56 - 8 * k)) & 0xff;
+		/* the history only keeps the start of long values */
+		erg[pos + 12] = h[j].len < 0xff ? h[j].len : 0xff;
+		erg[pos + 13] = len;
+		erg.setpart (h[j].data, pos + 14, len);
+	      }
+	  }
+	c->sendmessage (erg (), erg.array (), stop);
+      }
+      break;
+
+    case EIB_CACHE_SCAN:
+      if (c->size < 7)
+	{
+	  c->sendreject (stop);
+	  return;
+	}
+      scan (c, (c->buf[3] << 8) | (c->buf[4]), (c->buf[5] << 8) | (c->buf[6]),
+	    c->buf[2] & EIB_CACHE_SCAN_SNAPSHOT, stop);
+      break;
+
+    case EIB_OPEN_CACHE_FEED:
+      {
+	A_CacheFeed feed (cache, t, c);
+	feed.Do (stop);
+      }
+      break;
+
     default:
       c->sendreject (stop);
     }
 }
+
+A_CacheFeed::A_CacheFeed (GroupCache * gc, Trace * tr, ClientConnection * c)
+{
+  TRACEPRINTF (tr, 7, this, "Open A_CacheFeed");
+  cache = gc;
+  t = tr;
+  con = c;
+  Start ();
+}
+
+A_CacheFeed::~A_CacheFeed ()
+{
+  TRACEPRINTF (t, 7, this, "Close A_CacheFeed");
+  Stop ();
+}
+
+void
+A_CacheFeed::Run (pth_sem_t * stop1)
+{
+  pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  uint32_t cursor = cache->ChangePos ();
+  unsigned long dropped = 0;
+  uchar head[2];
+  CArray buf;
+
+  EIBSETTYPE (head, EIB_OPEN_CACHE_FEED);
+  if (con->sendmessage (2, head, stop) == -1)
+    goto out;
+
+  while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
+      if (!cache->WaitChange (cursor, stop))
+	continue;
+      uint32_t lost;
+      Array < GroupCacheChange > c = cache->Changes (cursor, 64, lost);
+      if (lost)
+	{
+	  dropped += lost;
+	  if (con->senddropped (dropped, stop) == -1)
+	    break;
+	}
+      for (unsigned i = 0; i < c (); i++)
+	{
+	  const GroupCacheSlot *s = 0;
+	  if (c[i].len > GROUPCACHE_INLINE)
+	    {
+	      /* the log only holds the start of long values; the full
+	       * value is taken from the cache, unless it was replaced */
+	      s = cache->Get (c[i].dst, 0);
+	      if (!s || s->src != c[i].src || s->len != c[i].len
+		  || s->recvtime != c[i].recvtime
+		  || memcmp (GroupCache::value (s), c[i].data,
+			     GROUPCACHE_INLINE))
+		{
+		  if (con->senddropped (++dropped, stop) == -1)
+		    goto out;
+		  continue;
+		}
+	    }
+	  buf.resize (10);
+	  EIBSETTYPE (buf, EIB_CACHE_UPDATE);
+	  buf[2] = (c[i].dst >> 8) & 0xff;
+	  buf[3] = (c[i].dst) & 0xff;
+	  buf[4] = (c[i].src >> 8) & 0xff;
+	  buf[5] = (c[i].src) & 0xff;
+	  buf[6] = (c[i].recvtime >> 24) & 0xff;
+	  buf[7] = (c[i].recvtime >> 16) & 0xff;
+	  buf[8] = (c[i].recvtime >> 8) & 0xff;
+	  buf[9] = (c[i].recvtime) & 0xff;
+	  if (s)
+	    buf.setpart (GroupCache::value (s), 10, s->len);
+	  else
+	    buf.setpart (c[i].data, 10, c[i].len);
+	  if (con->queuemessage (buf (), buf.array (), stop) == -1)
+	    goto out;
+	}
+      if (con->flush (stop) == -1)
+	break;
+    }
+out:
+  pth_event_free (stop, PTH_FREE_THIS);
+}
+
+void
+A_CacheFeed::Do (pth_event_t stop)
+{
+  while (1)
+    {
+      if (con->readmessage (stop) == -1)
+	break;
+      if (EIBTYPE (con->buf) == EIB_RESET_CONNECTION)
+	break;
+    }
+}
@@ -23,11 +23,43 @@
 #include "layer3.h"
 
 class ClientConnection;
+class GroupCache;
 
-bool CreateGroupCache (Layer3 * l3, Trace * t, bool enable);
+/** creates the group cache
+ * @param snapshot file to restore the cache from and to save it to, 0 to disable
+ * @param interval seconds between two snapshots
+ * @param logsize number of entries of the change log, 0 for the default
+ * @param readrate GroupValue_Read sent for cache misses per second, 0 for no limit
+ * @param history comma separated list of group address ranges with history:
+ * DEPTH[:FROM[-TO]], FROM and TO as main/middle/sub; without range, for all addresses
+ * @param proxyage answer GroupValue_Read of clients with cached values up to this age in seconds, 0 to disable
+ */
+bool CreateGroupCache (Layer3 * l3, Trace * t, bool enable,
+		       const char *snapshot = 0, unsigned interval = 0,
+		       unsigned logsize = 0, unsigned readrate = 20,
+		       const char *history = 0, unsigned proxyage = 0);
 void DeleteGroupCache ();
 
 void GroupCacheRequest (Layer3 * l3, Trace * t, ClientConnection * c,
 			pth_event_t stop);
 
+/** pushes the changes of the group cache to a client */
+class A_CacheFeed:private Thread
+{
+  /** group cache */
+  GroupCache *cache;
+  /** client connection */
+  ClientConnection *con;
+  /** debug output */
+  Trace *t;
+
+  void Run (pth_sem_t * stop);
+public:
+    A_CacheFeed (GroupCache * cache, Trace * tr, ClientConnection * c);
+    virtual ~ A_CacheFeed ();
+
+  /** start processing */
+  void Do (pth_event_t stop);
+};
+
 #endif
@@ -82,7 +82,9 @@ public:
 class L_Data_CallBack
 {
 public:
-  /** callback: a L_Data frame has been received */
+  /** callback: a L_Data frame has been received
+   * @param l shared frame, which must be released with unref
+   */
   virtual void Get_L_Data (L_Data_PDU * l) = 0;
 };
 
@@ -90,7 +92,9 @@ public:
 class L_Busmonitor_CallBack
 {
 public:
-  /** callback: a bus monitor frame has been received */
+  /** callback: a bus monitor frame has been received
+   * @param l shared frame, which must be released with unref
+   */
   virtual void Get_L_Busmonitor (L_Busmonitor_PDU * l) = 0;
 };
 
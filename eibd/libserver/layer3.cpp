@@ -19,41 +19,445 @@
 
 #include "layer3.h"
 
+Counter clientdropped ("clients.dropped");
+
+Layer2Reader::Layer2Reader (Layer3 * l3, Layer2Interface * l2,
+			    unsigned line)
+{
+  this->l3 = l3;
+  this->l2 = l2;
+  this->line = line;
+  Start ();
+}
+
+Layer2Reader::~Layer2Reader ()
+{
+  Stop ();
+}
+
+void
+Layer2Reader::Run (pth_sem_t * stop1)
+{
+  pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+
+  while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
+      LPDU *l = l2->Get_L_Data (stop);
+      if (l)
+	{
+	  if (!l->arrival)
+	    l->arrival = getMonotonicTime ();
+	  l3->recv_L_Data (l, line);
+	}
+    }
+  pth_event_free (stop, PTH_FREE_THIS);
+}
+
 Layer3::Layer3 (Layer2Interface * l2, Trace * tr)
 {
-  layer2 = l2;
   t = tr;
   TRACEPRINTF (t, 3, this, "Open");
-  l2->Open ();
   mode = 0;
+  groupcount = 0;
+  memset (grouppage, 0, sizeof (grouppage));
+  ignorehead = 0;
+  ignorecount = 0;
+  for (unsigned i = 0; i < IGNORE_HASH; i++)
+    ignorehash[i] = -1;
+  linetab = 0;
+  sentframes = 0;
+  responder = 0;
+  repeated.setName ("layer3.repeated");
+  filtered.setName ("layer3.filtered");
+  queued.setName ("layer3.queue");
+  dispatch.setName ("layer3.dispatch_us");
+  latency.setName ("layer3.latency_us");
+  pth_sem_init (&insignal);
+  addLayer2 (l2);
   Start ();
 }
 
 Layer3::~Layer3 ()
 {
+  unsigned i;
   TRACEPRINTF (t, 3, this, "Close");
   Stop ();
+  for (i = 0; i < layer2 (); i++)
+    delete layer2[i].reader;
+  while (!inqueue.isempty ())
+    inqueue.get ().l->unref ();
   if (mode)
-    layer2->leaveBusmonitor ();
+    leaveBusmonitor ();
   else
-    layer2->Close ();
+    for (i = 0; i < layer2 (); i++)
+      layer2[i].l2->Close ();
   while (vbusmonitor ())
     deregisterVBusmonitor (vbusmonitor[0].cb);
   while (group ())
     deregisterGroupCallBack (group[0].cb, group[0].dest);
+  for (i = 0; i < 0x100; i++)
+    while (grouppage[i])
+      {
+	unsigned j = 0;
+	while (!grouppage[i]->cb[j] ())
+	  j++;
+	deregisterGroupCallBack (grouppage[i]->cb[j][0], (i << 8) | j);
+      }
   while (individual ())
     deregisterIndividualCallBack (individual[0].cb, individual[0].src,
 				  individual[0].dest);
-  delete layer2;
+  for (i = 0; i < layer2 (); i++)
+    {
+      delete layer2[i].l2;
+      delete layer2[i].received;
+      delete layer2[i].sent;
+      if (layer2[i].groupfilter)
+	delete[]layer2[i].groupfilter;
+      if (layer2[i].indfilter)
+	delete[]layer2[i].indfilter;
+    }
+  if (linetab)
+    delete[]linetab;
+  if (sentframes)
+    delete[]sentframes;
+}
+
+bool
+Layer3::addLayer2 (Layer2Interface * l2)
+{
+  unsigned i, j;
+  TRACEPRINTF (t, 3, this, "addLayer2 %08X", l2);
+  if (mode)
+    {
+      if (!l2->enterBusmonitor ())
+	return 0;
+    }
+  else
+    l2->Open ();
+  if (vbusmonitor ())
+    l2->openVBusmonitor ();
+  for (i = 0; i < 0x100; i++)
+    if (grouppage[i])
+      for (j = 0; j < 0x100; j++)
+	if (grouppage[i]->cb[j] ())
+	  l2->addGroupAddress ((i << 8) | j);
+  for (i = 0; i < individual (); i++)
+    if (individual[i].dest)
+      l2->addAddress (individual[i].dest);
+
+  if (layer2 () == 1)
+    {
+      linetab = new uchar[0x10000];
+      memset (linetab, 0, 0x10000);
+      sentframes = new SentInfo[SENT_SIZE];
+      memset (sentframes, 0, sizeof (SentInfo) * SENT_SIZE);
+    }
+  i = layer2 ();
+  layer2.resize (i + 1);
+  layer2[i].l2 = l2;
+  layer2[i].received = new Counter;
+  layer2[i].received->setName ("layer3.line%d.received", i);
+  layer2[i].sent = new Counter;
+  layer2[i].sent->setName ("layer3.line%d.sent", i);
+  layer2[i].groupfilter = 0;
+  layer2[i].indfilter = 0;
+  layer2[i].reader = new Layer2Reader (this, l2, i);
+  return 1;
+}
+
+bool
+Layer3::addRouteFilter (unsigned line, eibaddr_t start, eibaddr_t end,
+			bool group)
+{
+  TRACEPRINTF (t, 3, this, "addRouteFilter %d %04X-%04X %d", line, start,
+	       end, group);
+  if (line >= layer2 () || start > end)
+    return 0;
+  uint32_t *&f = group ? layer2[line].groupfilter : layer2[line].indfilter;
+  if (!f)
+    {
+      f = new uint32_t[0x10000 / 32];
+      memset (f, 0, 0x10000 / 8);
+    }
+  for (unsigned a = start; a <= end; a++)
+    f[a >> 5] |= 1U << (a & 31);
+  return 1;
+}
+
+void
+Layer3::recv_L_Data (LPDU * l, unsigned line)
+{
+  Layer3_Frame f;
+  f.l = l;
+  f.line = line;
+  layer2[line].received->inc ();
+  queued.inc ();
+  inqueue.put (f);
+  pth_sem_inc (&insignal, 0);
+}
+
+bool
+Layer3::isDefaultAddr (eibaddr_t addr)
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    if (layer2[i].l2->getDefaultAddr () == addr)
+      return 1;
+  return 0;
+}
+
+bool
+Layer3::addGroupAddress (eibaddr_t addr)
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    if (!layer2[i].l2->addGroupAddress (addr))
+      {
+	while (i-- > 0)
+	  layer2[i].l2->removeGroupAddress (addr);
+	return 0;
+      }
+  return 1;
+}
+
+void
+Layer3::removeGroupAddress (eibaddr_t addr)
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    layer2[i].l2->removeGroupAddress (addr);
+}
+
+bool
+Layer3::addAddress (eibaddr_t addr)
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    if (!layer2[i].l2->addAddress (addr))
+      {
+	while (i-- > 0)
+	  layer2[i].l2->removeAddress (addr);
+	return 0;
+      }
+  return 1;
+}
+
+void
+Layer3::removeAddress (eibaddr_t addr)
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    layer2[i].l2->removeAddress (addr);
+}
+
+bool
+Layer3::enterBusmonitor ()
+{
+  unsigned i;
+  for (i = 0; i < layer2 (); i++)
+    layer2[i].l2->Close ();
+  for (i = 0; i < layer2 (); i++)
+    if (!layer2[i].l2->enterBusmonitor ())
+      {
+	while (i-- > 0)
+	  layer2[i].l2->leaveBusmonitor ();
+	for (i = 0; i < layer2 (); i++)
+	  layer2[i].l2->Open ();
+	return 0;
+      }
+  return 1;
+}
+
+void
+Layer3::leaveBusmonitor ()
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    layer2[i].l2->leaveBusmonitor ();
+}
+
+bool
+Layer3::openVBusmonitor ()
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    if (!layer2[i].l2->openVBusmonitor ())
+      {
+	while (i-- > 0)
+	  layer2[i].l2->closeVBusmonitor ();
+	return 0;
+      }
+  return 1;
+}
+
+void
+Layer3::closeVBusmonitor ()
+{
+  for (unsigned i = 0; i < layer2 (); i++)
+    layer2[i].l2->closeVBusmonitor ();
 }
 
 void
 Layer3::send_L_Data (L_Data_PDU * l)
 {
+  unsigned i, line = 0, cnt = layer2 ();
   TRACEPRINTF (t, 3, this, "Send %s", l->Decode ()());
+  if (!l->arrival)
+    l->arrival = getMonotonicTime ();
   if (l->source == 0)
-    l->source = layer2->getDefaultAddr ();
-  layer2->Send_L_Data (l);
+    l->source = layer2[0].l2->getDefaultAddr ();
+  if (responder && l->AddrType == GroupAddress)
+    {
+      L_Data_PDU *a = 0;
+      if (responder->Respond (l, a))
+	{
+	  TRACEPRINTF (t, 3, this, "Answered locally");
+	  l->unref ();
+	  if (a)
+	    deliver (a);
+	  return;
+	}
+    }
+  if (l->AddrType == IndividualAddress && linetab && linetab[l->dest])
+    {
+      line = linetab[l->dest] - 1;
+      cnt = 1;
+    }
+  for (i = 1; i < cnt; i++)
+    {
+      L_Data_PDU *c = new L_Data_PDU (*l);
+      c->route = L_Route_Copy;
+      send (c, (line + i) % layer2 ());
+    }
+  l->route = L_Route_Local;
+  send (l, line);
+}
+
+/** computes a FNV-1a digest of a L_Data frame, ignoring the repeat flag */
+static uint64_t
+frameDigest (const L_Data_PDU * l)
+{
+  uchar head[7];
+  uint64_t h = 0xcbf29ce484222325ULL;
+  unsigned i;
+
+  head[0] = l->prio;
+  head[1] = l->AddrType;
+  head[2] = l->hopcount;
+  head[3] = (l->source >> 8) & 0xff;
+  head[4] = (l->source) & 0xff;
+  head[5] = (l->dest >> 8) & 0xff;
+  head[6] = (l->dest) & 0xff;
+  for (i = 0; i < sizeof (head); i++)
+    h = (h ^ head[i]) * 0x100000001b3ULL;
+  for (i = 0; i < l->data (); i++)
+    h = (h ^ l->data[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+/** combines the digest of a frame with the line, on which it is sent */
+static uint64_t
+sentDigest (const L_Data_PDU * l, unsigned line)
+{
+  return frameDigest (l) ^ ((line + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+void
+Layer3::addSent (const L_Data_PDU * l, unsigned line)
+{
+  uint64_t digest = sentDigest (l, line);
+  SentInfo & e = sentframes[digest & (SENT_SIZE - 1)];
+  e.digest = digest;
+  /* the echo may wait behind the send queue of a slow backend */
+  e.end = getMonotonicTime () + 10000000000LL;
+  e.route = l->route;
+}
+
+L_Data_Route
+Layer3::findSent (const L_Data_PDU * l, unsigned line, timestamp_t now)
+{
+  uint64_t digest = sentDigest (l, line);
+  SentInfo & e = sentframes[digest & (SENT_SIZE - 1)];
+  if (e.digest != digest || e.end < now)
+    return L_Route_None;
+  e.end = 0;
+  return e.route;
+}
+
+bool
+Layer3::routeAllowed (const L_Data_PDU * l, unsigned line)
+{
+  const uint32_t *f;
+  if (l->AddrType == GroupAddress)
+    {
+      /* broadcasts pass all lines */
+      if (l->dest == 0)
+	return 1;
+      f = layer2[line].groupfilter;
+    }
+  else
+    f = layer2[line].indfilter;
+  return !f || (f[l->dest >> 5] >> (l->dest & 31)) & 1;
+}
+
+void
+Layer3::send (L_Data_PDU * l, unsigned line)
+{
+  if (sentframes)
+    addSent (l, line);
+  layer2[line].sent->inc ();
+  layer2[line].l2->Send_L_Data (l);
+}
+
+void
+Layer3::deliver (L_Data_PDU * l)
+{
+  Layer3_Frame f;
+  if (!l->arrival)
+    l->arrival = getMonotonicTime ();
+  l->route = L_Route_Local;
+  f.l = l;
+  f.line = 0;
+  queued.inc ();
+  inqueue.put (f);
+  pth_sem_inc (&insignal, 0);
+}
+
+void
+Layer3::setResponder (L_Data_Responder * r)
+{
+  responder = r;
+}
+
+void
+Layer3::route_L_Data (L_Data_PDU * l, unsigned line)
+{
+  unsigned i;
+  if (layer2 () < 2)
+    return;
+  linetab[l->source] = line + 1;
+  if (!l->hopcount)
+    return;
+  if (l->AddrType == IndividualAddress)
+    {
+      if (isDefaultAddr (l->dest))
+	return;
+      if (linetab[l->dest] == line + 1)
+	return;
+    }
+  for (i = 0; i < layer2 (); i++)
+    {
+      if (i == line)
+	continue;
+      if (l->AddrType == IndividualAddress && linetab[l->dest]
+	  && linetab[l->dest] != i + 1)
+	continue;
+      if (!routeAllowed (l, i))
+	{
+	  TRACEPRINTF (t, 3, this, "Route %d->%d filtered", line, i);
+	  continue;
+	}
+      L_Data_PDU *c = new L_Data_PDU (*l);
+      if (c->hopcount < 7)
+	c->hopcount--;
+      c->repeated = 0;
+      c->route = L_Route_Copy;
+      TRACEPRINTF (t, 3, this, "Route %d->%d %s", line, i, c->Decode ()());
+      send (c, i);
+    }
 }
 
 bool
@@ -68,8 +472,9 @@ Layer3::deregisterBusmonitor (L_Busmonitor_CallBack * c)
 	if (busmonitor () == 0)
 	  {
 	    mode = 0;
-	    layer2->leaveBusmonitor ();
-	    layer2->Open ();
+	    leaveBusmonitor ();
+	    for (unsigned j = 0; j < layer2 (); j++)
+	      layer2[j].l2->Open ();
 	  }
 	TRACEPRINTF (t, 3, this, "deregisterBusmonitor %08X = 1", c);
 	return 1;
@@ -89,7 +494,7 @@ Layer3::deregisterVBusmonitor (L_Busmonitor_CallBack * c)
 	vbusmonitor.resize (vbusmonitor () - 1);
 	if (vbusmonitor () == 0)
 	  {
-	    layer2->closeVBusmonitor ();
+	    closeVBusmonitor ();
 	  }
 	TRACEPRINTF (t, 3, this, "deregisterVBusmonitor %08X = 1", c);
 	return 1;
@@ -119,21 +524,42 @@ bool
 Layer3::deregisterGroupCallBack (L_Data_CallBack * c, eibaddr_t addr)
 {
   unsigned i;
-  for (i = 0; i < group (); i++)
-    if (group[i].cb == c && group[i].dest == addr)
-      {
-	group[i] = group[group () - 1];
-	group.resize (group () - 1);
-	TRACEPRINTF (t, 3, this, "deregisterGroupCallBack %08X = 1", c);
-	for (i = 0; i < group (); i++)
+  if (!addr)
+    {
+      for (i = 0; i < group (); i++)
+	if (group[i].cb == c)
+	  {
+	    group[i] = group[group () - 1];
+	    group.resize (group () - 1);
+	    TRACEPRINTF (t, 3, this, "deregisterGroupCallBack %08X = 1", c);
+	    return 1;
+	  }
+      TRACEPRINTF (t, 3, this, "deregisterGroupCallBack %08X = 0", c);
+      return 0;
+    }
+
+  Group_Page *p = grouppage[(addr >> 8) & 0xff];
+  if (p)
+    {
+      Array < L_Data_CallBack * >&cb = p->cb[addr & 0xff];
+      for (i = 0; i < cb (); i++)
+	if (cb[i] == c)
 	  {
-	    if (group[i].dest == addr)
+	    cb[i] = cb[cb () - 1];
+	    cb.resize (cb () - 1);
+	    groupcount--;
+	    TRACEPRINTF (t, 3, this, "deregisterGroupCallBack %08X = 1", c);
+	    if (cb ())
 	      return 1;
+	    removeGroupAddress (addr);
+	    if (--p->count == 0)
+	      {
+		grouppage[(addr >> 8) & 0xff] = 0;
+		delete p;
+	      }
+	    return 1;
 	  }
-	if (addr)
-	  layer2->removeGroupAddress (addr);
-	return 1;
-      }
+    }
   TRACEPRINTF (t, 3, this, "deregisterGroupCallBack %08X = 0", c);
   return 0;
 
@@ -157,7 +583,7 @@ bool
 	      return 1;
 	  }
 	if (dest)
-	  layer2->removeAddress (dest);
+	  removeAddress (dest);
 	return 1;
       }
   TRACEPRINTF (t, 3, this, "deregisterIndividual %08X = 0", c);
@@ -165,40 +591,40 @@ bool
 }
 
 bool
-Layer3::registerBusmonitor (L_Busmonitor_CallBack * c)
+Layer3::registerBusmonitor (L_Busmonitor_CallBack * c,
+			    const FrameFilter * f)
 {
   TRACEPRINTF (t, 3, this, "registerBusmontior %08X", c);
   if (individual ())
     return 0;
-  if (group ())
+  if (group () || groupcount)
     return 0;
   if (broadcast ())
     return 0;
   if (mode == 0)
     {
-      layer2->Close ();
-      if (!layer2->enterBusmonitor ())
-	{
-	  layer2->Open ();
-	  return 0;
-	}
+      if (!enterBusmonitor ())
+	return 0;
     }
   mode = 1;
   busmonitor.resize (busmonitor () + 1);
   busmonitor[busmonitor () - 1].cb = c;
+  busmonitor[busmonitor () - 1].filter = f;
   TRACEPRINTF (t, 3, this, "registerBusmontior %08X = 1", c);
   return 1;
 }
 
 bool
-Layer3::registerVBusmonitor (L_Busmonitor_CallBack * c)
+Layer3::registerVBusmonitor (L_Busmonitor_CallBack * c,
+			     const FrameFilter * f)
 {
   TRACEPRINTF (t, 3, this, "registerVBusmonitor %08X", c);
-  if (!vbusmonitor () && !layer2->openVBusmonitor ())
+  if (!vbusmonitor () && !openVBusmonitor ())
     return 0;
 
   vbusmonitor.resize (vbusmonitor () + 1);
   vbusmonitor[vbusmonitor () - 1].cb = c;
+  vbusmonitor[vbusmonitor () - 1].filter = f;
   TRACEPRINTF (t, 3, this, "registerVBusmontior %08X = 1", c);
   return 1;
 }
@@ -216,24 +642,37 @@ Layer3::registerBroadcastCallBack (L_Data_CallBack * c)
 }
 
 bool
-Layer3::registerGroupCallBack (L_Data_CallBack * c, eibaddr_t addr)
+Layer3::registerGroupCallBack (L_Data_CallBack * c, eibaddr_t addr,
+			       const FrameFilter * f)
 {
-  unsigned i;
   TRACEPRINTF (t, 3, this, "registerGroup %08X", c);
   if (mode == 1)
     return 0;
-  for (i = 0; i < group (); i++)
+  if (!addr)
     {
-      if (group[i].dest == addr)
-	break;
+      group.resize (group () + 1);
+      group[group () - 1].cb = c;
+      group[group () - 1].dest = 0;
+      group[group () - 1].filter = f;
+      TRACEPRINTF (t, 3, this, "registerGroup %08X = 1", c);
+      return 1;
     }
-  if (i == group ())
-    if (addr)
-      if (!layer2->addGroupAddress (addr))
-	return 0;
-  group.resize (group () + 1);
-  group[group () - 1].cb = c;
-  group[group () - 1].dest = addr;
+
+  Group_Page *p = grouppage[(addr >> 8) & 0xff];
+  if (!p || !p->cb[addr & 0xff] ())
+    if (!addGroupAddress (addr))
+      return 0;
+  if (!p)
+    {
+      p = new Group_Page;
+      p->count = 0;
+      grouppage[(addr >> 8) & 0xff] = p;
+    }
+  Array < L_Data_CallBack * >&cb = p->cb[addr & 0xff];
+  if (!cb ())
+    p->count++;
+  cb.add (c);
+  groupcount++;
   TRACEPRINTF (t, 3, this, "registerGroup %08X = 1", c);
   return 1;
 }
@@ -263,7 +702,7 @@ bool
 	break;
     }
   if (i == individual () && dest)
-    if (!layer2->addAddress (dest))
+    if (!addAddress (dest))
       return 0;
   individual.resize (individual () + 1);
   individual[individual () - 1].cb = c;
@@ -274,69 +713,162 @@ bool
   return 1;
 }
 
+void
+Layer3::popIgnore ()
+{
+  int *p = &ignorehash[ignore[ignorehead].digest & (IGNORE_HASH - 1)];
+  /* the oldest entry is always the last one of its chain */
+  while (*p != (int) ignorehead)
+    p = &ignore[*p].next;
+  *p = -1;
+  ignorehead = (ignorehead + 1) & (IGNORE_SIZE - 1);
+  ignorecount--;
+}
+
+void
+Layer3::expireIgnore (timestamp_t now)
+{
+  while (ignorecount && ignore[ignorehead].end < now)
+    popIgnore ();
+}
+
+bool
+Layer3::findIgnore (uint64_t digest)
+{
+  int i = ignorehash[digest & (IGNORE_HASH - 1)];
+  while (i != -1)
+    {
+      if (ignore[i].digest == digest)
+	return 1;
+      i = ignore[i].next;
+    }
+  return 0;
+}
+
+void
+Layer3::addIgnore (uint64_t digest, timestamp_t end)
+{
+  if (ignorecount == IGNORE_SIZE)
+    popIgnore ();
+  unsigned pos = (ignorehead + ignorecount) & (IGNORE_SIZE - 1);
+  int *bucket = &ignorehash[digest & (IGNORE_HASH - 1)];
+  ignore[pos].digest = digest;
+  ignore[pos].end = end;
+  ignore[pos].next = *bucket;
+  *bucket = pos;
+  ignorecount++;
+}
+
 void
 Layer3::Run (pth_sem_t * stop1)
 {
   pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  pth_event_t getwait = pth_event (PTH_EVENT_SEM, &insignal);
   unsigned i;
 
   while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
     {
-      LPDU *l = layer2->Get_L_Data (stop);
-      if (!l)
+      pth_event_concat (getwait, stop, NULL);
+      pth_wait (getwait);
+      pth_event_isolate (getwait);
+      if (pth_event_status (getwait) != PTH_STATUS_OCCURRED)
 	continue;
+      pth_sem_dec (&insignal);
+      Layer3_Frame f = inqueue.get ();
+      LPDU *l = f.l;
+      timestamp_t start = getMonotonicTime ();
+      queued.dec ();
+      if (l->arrival)
+	latency.add ((start - l->arrival) / 1000);
+      unsigned long allocations = LPDU::allocations;
       if (l->getType () == L_Busmonitor)
 	{
-	  L_Busmonitor_PDU *l1, *l2;
+	  L_Busmonitor_PDU *l1;
 	  l1 = (L_Busmonitor_PDU *) l;
 
 	  TRACEPRINTF (t, 3, this, "Recv %s", l1->Decode ()());
 	  for (i = 0; i < busmonitor (); i++)
 	    {
-	      l2 = new L_Busmonitor_PDU (*l1);
-	      busmonitor[i].cb->Get_L_Busmonitor (l2);
+	      if (busmonitor[i].filter && !busmonitor[i].filter->match (l1))
+		{
+		  filtered.inc ();
+		  continue;
+		}
+	      l1->ref ();
+	      busmonitor[i].cb->Get_L_Busmonitor (l1);
 	    }
 	  for (i = 0; i < vbusmonitor (); i++)
 	    {
-	      l2 = new L_Busmonitor_PDU (*l1);
-	      vbusmonitor[i].cb->Get_L_Busmonitor (l2);
+	      if (vbusmonitor[i].filter && !vbusmonitor[i].filter->match (l1))
+		{
+		  filtered.inc ();
+		  continue;
+		}
+	      l1->ref ();
+	      vbusmonitor[i].cb->Get_L_Busmonitor (l1);
 	    }
 	}
       if (l->getType () == L_Data)
 	{
 	  L_Data_PDU *l1;
 	  l1 = (L_Data_PDU *) l;
-	  if (l1->repeated)
+	  timestamp_t now = l1->arrival ? l1->arrival : start;
+	  if (sentframes)
+	    {
+	      L_Data_Route r = findSent (l1, f.line, now);
+	      if (l1->route == L_Route_None)
+		l1->route = r;
+	    }
+	  if (l1->route == L_Route_Copy)
+	    goto wt;
+	  uint64_t digest = frameDigest (l1);
+	  expireIgnore (now);
+	  if (l1->repeated && findIgnore (digest))
 	    {
-	      CArray d1 = l1->ToPacket ();
-	      for (i = 0; i < ignore (); i++)
-		if (d1 == ignore[i].data)
-		  {
-		    TRACEPRINTF (t, 3, this, "Repeated discareded");
-		    goto wt;
-		  }
+	      TRACEPRINTF (t, 3, this, "Repeated discareded");
+	      repeated.inc ();
+	      goto wt;
 	    }
-	  l1->repeated = 1;
-	  ignore.resize (ignore () + 1);
-	  ignore[ignore () - 1].data = l1->ToPacket ();
-	  ignore[ignore () - 1].end = getTime () + 1000000;
+	  addIgnore (digest, now + 1000000000LL);
 	  l1->repeated = 0;
+	  if (l1->route == L_Route_None)
+	    route_L_Data (l1, f.line);
 
 	  if (l1->AddrType == IndividualAddress
-	      && l1->dest == layer2->getDefaultAddr ())
+	      && l1->dest == layer2[f.line].l2->getDefaultAddr ())
 	    l1->dest = 0;
 	  TRACEPRINTF (t, 3, this, "Recv %s", l1->Decode ()());
 
 	  if (l1->AddrType == GroupAddress && l1->dest == 0)
 	    {
 	      for (i = 0; i < broadcast (); i++)
-		broadcast[i].cb->Get_L_Data (new L_Data_PDU (*l1));
+		{
+		  l1->ref ();
+		  broadcast[i].cb->Get_L_Data (l1);
+		}
 	    }
 	  if (l1->AddrType == GroupAddress && l1->dest != 0)
 	    {
+	      Group_Page *p = grouppage[(l1->dest >> 8) & 0xff];
+	      if (p)
+		{
+		  Array < L_Data_CallBack * >&cb = p->cb[l1->dest & 0xff];
+		  for (i = 0; i < cb (); i++)
+		    {
+		      l1->ref ();
+		      cb[i]->Get_L_Data (l1);
+		    }
+		}
 	      for (i = 0; i < group (); i++)
-		if (group[i].dest == l1->dest || group[i].dest == 0)
-		  group[i].cb->Get_L_Data (new L_Data_PDU (*l1));
+		{
+		  if (group[i].filter && !group[i].filter->match (l1))
+		    {
+		      filtered.inc ();
+		      continue;
+		    }
+		  l1->ref ();
+		  group[i].cb->Get_L_Data (l1);
+		}
 	    }
 	  if (l1->AddrType == IndividualAddress)
 	    {
@@ -344,19 +876,18 @@ Layer3::Run (pth_sem_t * stop1)
 		if (individual[i].dest == l1->dest)
 		  if (individual[i].src == l1->source
 		      || individual[i].src == 0)
-		    individual[i].cb->Get_L_Data (new L_Data_PDU (*l1));
+		    {
+		      l1->ref ();
+		      individual[i].cb->Get_L_Data (l1);
+		    }
 	    }
 	}
-    redel:
-      for (i = 0; i < ignore (); i++)
-	if (ignore[i].end < getTime ())
-	  {
-	    ignore.deletepart (i, 1);
-	    goto redel;
-	  }
     wt:
-      delete l;
-
+      TRACEPRINTF (t, 3, this, "Frame allocations: %lu",
+		   LPDU::allocations - allocations);
+      l->unref ();
+      dispatch.since (start);
     }
+  pth_event_free (getwait, PTH_FREE_THIS);
   pth_event_free (stop, PTH_FREE_THIS);
 }
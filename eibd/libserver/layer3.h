@@ -21,11 +21,15 @@
 #define LAYER3_H
 
 #include "layer2.h"
+#include "metrics.h"
+#include "filter.h"
 
 /** stores a registered busmonitor callback */
 typedef struct
 {
   L_Busmonitor_CallBack *cb;
+  /** frames, which should be delivered, 0 for all */
+  const FrameFilter *filter;
 } Busmonitor_Info;
 
 /** stores a registered broadcast callback */
@@ -40,8 +44,20 @@ typedef struct
   L_Data_CallBack *cb;
   /** group address, for which the frames should be delivered */
   eibaddr_t dest;
+  /** frames, which should be delivered, 0 for all */
+  const FrameFilter *filter;
 } Group_Info;
 
+/** stores the group callbacks of 256 consecutive group addresses */
+typedef struct
+{
+  /** number of group addresses of this page with at least one callback;
+   * the page is freed, when it drops to 0 */
+  unsigned count;
+  /** callbacks, indexed by the low byte of the group address */
+    Array < L_Data_CallBack * >cb[0x100];
+} Group_Page;
+
 typedef enum
 {
   /** perform no locking */
@@ -62,23 +78,140 @@ typedef struct
   Individual_Lock lock;
 } Individual_Info;
 
+/** answers frames of clients locally instead of sending them */
+class L_Data_Responder
+{
+public:
+  virtual ~ L_Data_Responder ()
+  {
+  }
+  /** decides, whether l is sent
+   * @param l frame of a client
+   * @param answer set to a frame, which is delivered to the clients
+   * @return true, if l must not be sent
+   */
+  virtual bool Respond (L_Data_PDU * l, L_Data_PDU * &answer) = 0;
+};
+
+/** capacity of the repeated frame filter (power of 2) */
+#define IGNORE_SIZE 0x100
+/** number of hash buckets of the repeated frame filter (power of 2) */
+#define IGNORE_HASH 0x100
+
+/** stores a recently seen frame for the repeated frame filter */
 typedef struct
 {
-  CArray data;
+  /** digest of the frame */
+  uint64_t digest;
+  /** end of the ignore interval (getMonotonicTime) */
   timestamp_t end;
-
+  /** next entry in the same hash bucket, -1 terminates the chain */
+  int next;
 } IgnoreInfo;
 
-/** Layer 3 frame dispatches */
-class Layer3:private Thread
+/** number of slots of the table of frames sent to the lines (power of 2) */
+#define SENT_SIZE 0x400
+
+/** stores a frame sent to a line to recognize its echo, as backends,
+ * which parse their echo again, lose L_Data_PDU::route */
+typedef struct
+{
+  /** digest of the frame and the line */
+  uint64_t digest;
+  /** end of the echo interval (getMonotonicTime), 0 if unused */
+  timestamp_t end;
+  /** routing state of the sent frame */
+  L_Data_Route route;
+} SentInfo;
+
+/** packets dropped because of a full client receive queue
+ * (see Layer3::queuelimit) */
+extern Counter clientdropped;
+
+class Layer3;
+
+/** reads the frames of a backend and passes them to Layer 3 */
+class Layer2Reader:private Thread
+{
+  /** Layer 3 */
+  Layer3 *l3;
+  /** backend */
+  Layer2Interface *l2;
+  /** index of the backend in Layer 3 */
+  unsigned line;
+
+  void Run (pth_sem_t * stop);
+public:
+    Layer2Reader (Layer3 * l3, Layer2Interface * l2, unsigned line);
+    virtual ~ Layer2Reader ();
+};
+
+/** stores a backend (line) of Layer 3 */
+typedef struct
 {
   /** Layer 2 interface */
-  Layer2Interface *layer2;
+  Layer2Interface *l2;
+  /** reader thread */
+  Layer2Reader *reader;
+  /** frames received from the line */
+  Counter *received;
+  /** frames sent to the line */
+  Counter *sent;
+  /** bitmap of the group addresses routed to the line, 0 for all */
+  uint32_t *groupfilter;
+  /** bitmap of the individual addresses routed to the line, 0 for all */
+  uint32_t *indfilter;
+} Layer2_Info;
+
+/** stores a received frame with its line */
+typedef struct
+{
+  LPDU *l;
+  /** index of the backend, which received the frame */
+  unsigned line;
+} Layer3_Frame;
+
+/** Layer 3 frame dispatches and routing between the backends */
+class Layer3:private Thread
+{
+  friend class Layer2Reader;
+
+  /** Layer 2 interfaces; the first one is the default line */
+    Array < Layer2_Info > layer2;
+  /** line of each individual address (index + 1, 0 if unknown);
+   * only allocated with more than one line */
+  uchar *linetab;
+  /** frames sent to the lines, indexed by their digest;
+   * only allocated with more than one line */
+  SentInfo *sentframes;
+  /** received frames */
+    Queue < Layer3_Frame > inqueue;
+  /** semaphore for the received frames */
+  pth_sem_t insignal;
   /** debug output */
   Trace *t;
   /** working mode (bus monitor/normal operation) */
   int mode;
-    Array < IgnoreInfo > ignore;
+  /** recently seen frames, a FIFO ring ordered by expiry time */
+  IgnoreInfo ignore[IGNORE_SIZE];
+  /** first entry of each hash bucket, -1 if empty */
+  int ignorehash[IGNORE_HASH];
+  /** index of the oldest entry */
+  unsigned ignorehead;
+  /** number of entries */
+  unsigned ignorecount;
+  /** discarded repeated frames */
+  Counter repeated;
+  /** frames not delivered to a callback because of its filter */
+  Counter filtered;
+  /** length of inqueue */
+  Gauge queued;
+  /** time to dispatch a frame to the callbacks */
+  Histogram dispatch;
+  /** time from the arrival of a frame to its dispatch */
+  Histogram latency;
+  /** answers group frames of clients, 0 if none */
+  L_Data_Responder *responder;
 
     /** busmonitor callbacks */
     Array < Busmonitor_Info > busmonitor;
@@ -86,27 +219,108 @@ class Layer3:private Thread
     Array < Busmonitor_Info > vbusmonitor;
     /** broadcast callbacks */
     Array < Broadcast_Info > broadcast;
-    /** group callbacks */
+    /** group callbacks for all group addresses (dest == 0) */
     Array < Group_Info > group;
+    /** group callbacks for a specific address, indexed by the high byte
+     * of the group address; pages are allocated on demand */
+  Group_Page *grouppage[0x100];
+    /** number of group callbacks for a specific address */
+  unsigned groupcount;
     /** individual callbacks */
     Array < Individual_Info > individual;
 
+  /** drops the oldest entry of the repeated frame filter */
+  void popIgnore ();
+  /** drops all entries of the repeated frame filter expired at now */
+  void expireIgnore (timestamp_t now);
+  /** returns true, if a frame with digest is in the repeated frame filter */
+  bool findIgnore (uint64_t digest);
+  /** adds a frame to the repeated frame filter */
+  void addIgnore (uint64_t digest, timestamp_t end);
+  /** remembers, that l was sent on line */
+  void addSent (const L_Data_PDU * l, unsigned line);
+  /** returns the routing state of the frame sent on line, which l echos,
+   * L_Route_None if l is no echo; the entry is consumed */
+  L_Data_Route findSent (const L_Data_PDU * l, unsigned line,
+			 timestamp_t now);
+  /** returns true, if the filter tables of line pass l */
+  bool routeAllowed (const L_Data_PDU * l, unsigned line);
+
+  /** sends l on line */
+  void send (L_Data_PDU * l, unsigned line);
+  /** delivers l to the local clients only, as if it was echoed by
+   * the first line */
+  void deliver (L_Data_PDU * l);
+  /** queues a frame received by the backend line */
+  void recv_L_Data (LPDU * l, unsigned line);
+  /** forwards a frame received on line to the other lines */
+  void route_L_Data (L_Data_PDU * l, unsigned line);
+  /** returns true, if addr is the default address of one line */
+  bool isDefaultAddr (eibaddr_t addr);
+
+  /** add the group address to all lines, return true if successful */
+  bool addGroupAddress (eibaddr_t addr);
+  /** remove the group address from all lines */
+  void removeGroupAddress (eibaddr_t addr);
+  /** add the individual address to all lines, return true if successful */
+  bool addAddress (eibaddr_t addr);
+  /** remove the individual address from all lines */
+  void removeAddress (eibaddr_t addr);
+  /** switch all lines to the busmonitor mode, return true if successful */
+  bool enterBusmonitor ();
+  /** switch all lines back to normal operation */
+  void leaveBusmonitor ();
+  /** opens the vbusmonitor of all lines, return true if successful */
+  bool openVBusmonitor ();
+  /** closes the vbusmonitor of all lines */
+  void closeVBusmonitor ();
+
   void Run (pth_sem_t * stop);
 public:
     Layer3 (Layer2Interface * l2, Trace * tr);
     virtual ~ Layer3 ();
 
-    /** register a busmonitor callback, return true, if successful*/
-  bool registerBusmonitor (L_Busmonitor_CallBack * c);
-    /** register a vbusmonitor callback, return true, if successful*/
-  bool registerVBusmonitor (L_Busmonitor_CallBack * c);
+  /** limit of the receive queue of each client, set before clients
+   * are connected */
+  QueueLimit queuelimit;
+
+    /** adds an additional backend as new line; frames are forwarded
+     * between the lines like a line coupler
+     * @param l2 initialized backend, which is owned by Layer 3 afterwards
+     * @return true, if successful
+     */
+  bool addLayer2 (Layer2Interface * l2);
+    /** restricts the frames routed to a line to the destination
+     * addresses start..end; without a range of the address type,
+     * all frames of this type are routed
+     * @param line index of the backend
+     * @param group true for group addresses, false for individual ones
+     * @return true, if successful
+     */
+  bool addRouteFilter (unsigned line, eibaddr_t start, eibaddr_t end,
+		       bool group);
+
+    /** register a busmonitor callback, return true, if successful
+     * @param c callback
+     * @param f frames, which should be delivered (0 means all)
+     */
+  bool registerBusmonitor (L_Busmonitor_CallBack * c,
+			   const FrameFilter * f = 0);
+    /** register a vbusmonitor callback, return true, if successful
+     * @param c callback
+     * @param f frames, which should be delivered (0 means all)
+     */
+  bool registerVBusmonitor (L_Busmonitor_CallBack * c,
+			    const FrameFilter * f = 0);
     /** register a broadcast callback, return true, if successful*/
   bool registerBroadcastCallBack (L_Data_CallBack * c);
     /** register a group callback, return true, if successful
      * @param c callback
      * @param addr group address (0 means all)
+     * @param f frames, which should be delivered, if addr is 0 (0 means all)
      */
-  bool registerGroupCallBack (L_Data_CallBack * c, eibaddr_t addr);
+  bool registerGroupCallBack (L_Data_CallBack * c, eibaddr_t addr,
+			      const FrameFilter * f = 0);
     /** register a individual callback, return true, if successful
      * @param c callback
      * @param src source individual address (0 means all)
@@ -134,8 +348,14 @@ public:
      */
   bool deregisterIndividualCallBack (L_Data_CallBack * c, eibaddr_t src,
 				     eibaddr_t dest = 0);
-  /** sends a L_Data frame asynchronouse */
+  /** sends a L_Data frame asynchronouse
+   * group frames are sent on all lines, individual frames on the line
+   * of the destination, if it is known, else on all lines
+   */
   void send_L_Data (L_Data_PDU * l);
+  /** sets the responder, which may answer group frames of clients
+   * instead of the bus; 0 removes it */
+  void setResponder (L_Data_Responder * r);
 };
 
 
@@ -20,6 +20,9 @@
 #include "layer4.h"
 #include "tpdu.h"
 
+/** repeated T_Data_Connected frames */
+static Counter repeats ("layer4.connection.repeats");
+
 T_Broadcast::T_Broadcast (Layer3 * l3, Trace * tr, int write_only)
 {
   TRACEPRINTF (tr, 4, this, "OpenBroadcast %s", write_only ? "WO" : "RW");
@@ -58,7 +61,7 @@ T_Broadcast::Get_L_Data (L_Data_PDU * l)
       pth_sem_inc (&sem, 0);
     }
   delete t;
-  delete l;
+  l->unref ();
 }
 
 void
@@ -98,13 +101,16 @@ T_Broadcast::Get (pth_event_t stop)
   return 0;
 }
 
-T_Group::T_Group (Layer3 * l3, Trace * tr, eibaddr_t group, int write_only)
+T_Group::T_Group (Layer3 * l3, Trace * tr, eibaddr_t group, int write_only,
+		  Overflow_CallBack * oc)
 {
   TRACEPRINTF (tr, 4, this, "OpenGroup %d/%d/%d %s", (group >> 11) & 0x1f,
 	       (group >> 8) & 0x07, (group) & 0xff, write_only ? "WO" : "RW");
   layer3 = l3;
   t = tr;
   groupaddr = group;
+  this->oc = oc;
+  outqueue.setLimit (l3->queuelimit);
   pth_sem_init (&sem);
   init_ok = false;
   if (group == 0)
@@ -131,11 +137,34 @@ T_Group::Get_L_Data (L_Data_PDU * l)
       T_DATA_XXX_REQ_PDU *t1 = (T_DATA_XXX_REQ_PDU *) t;
       c.data = t1->data;
       c.src = l->source;
-      outqueue.put (c);
-      pth_sem_inc (&sem, 0);
+      if (!outqueue.full ())
+	{
+	  outqueue.put (c);
+	  pth_sem_inc (&sem, 0);
+	}
+      else
+	Overflow (c);
     }
   delete t;
-  delete l;
+  l->unref ();
+}
+
+void
+T_Group::Overflow (const GroupComm & c)
+{
+  clientdropped.inc ();
+  if (outqueue.overflow ())
+    {
+      outqueue.get ();
+      outqueue.put (c);
+    }
+  TRACEPRINTF (t, 4, this, "Group queue full, %lu dropped",
+	       outqueue.dropped);
+  if (outqueue.disconnect && oc)
+    {
+      oc->Overflow ();
+      oc = 0;
+    }
 }
 
 void
@@ -209,7 +238,7 @@ T_TPDU::Get_L_Data (L_Data_PDU * l)
   t.addr = l->source;
   outqueue.put (t);
   pth_sem_inc (&sem, 0);
-  delete l;
+  l->unref ();
 }
 
 void
@@ -287,7 +316,7 @@ T_Individual::Get_L_Data (L_Data_PDU * l)
       pth_sem_inc (&sem, 0);
     }
   delete t;
-  delete l;
+  l->unref ();
 }
 
 void
@@ -359,7 +388,7 @@ T_Connection::~T_Connection ()
   TRACEPRINTF (t, 4, this, "CloseConnection");
   Stop ();
   while (!buf.isempty ())
-    delete buf.get ();
+    buf.get ()->unref ();
   layer3->deregisterIndividualCallBack (this, dest);
 }
 
@@ -478,7 +507,7 @@ T_Connection::Run (pth_sem_t * stop1)
   pth_event_t bufev = pth_event (PTH_EVENT_SEM, &bufsem);
 
   while (!buf.isempty ())
-    delete buf.get ();
+    buf.get ()->unref ();
 
   pth_sem_set_value (&bufsem, 0);
 
@@ -547,6 +576,7 @@ T_Connection::Run (pth_sem_t * stop1)
 		else
 		  {
 		    repcount++;
+		    repeats.inc ();
 		    SendData (sendno, in.top ());
 		    timeout =
 		      pth_event (PTH_EVENT_RTIME | PTH_MODE_REUSE, timeout,
@@ -576,7 +606,7 @@ T_Connection::Run (pth_sem_t * stop1)
 	      /* ignore */ ;
 	    }
 	  delete t;
-	  delete l;
+	  l->unref ();
 	}
       else if (pth_event_status (inev) == PTH_STATUS_OCCURRED && mode == 1)
 	{
@@ -593,6 +623,7 @@ T_Connection::Run (pth_sem_t * stop1)
 	  if (mode == 2 && repcount < 3)
 	    {
 	      repcount++;
+	      repeats.inc ();
 	      SendData (sendno, in.top ());
 	      timeout =
 		pth_event (PTH_EVENT_RTIME | PTH_MODE_REUSE, timeout,
@@ -613,15 +644,18 @@ T_Connection::Run (pth_sem_t * stop1)
   pth_sem_inc (&outsem, 0);
 }
 
-GroupSocket::GroupSocket (Layer3 * l3, Trace * tr, int write_only)
+GroupSocket::GroupSocket (Layer3 * l3, Trace * tr, int write_only,
+			  Overflow_CallBack * oc, const FrameFilter * f)
 {
   TRACEPRINTF (tr, 4, this, "OpenGroupSocket %s", write_only ? "WO" : "RW");
   layer3 = l3;
   t = tr;
+  this->oc = oc;
+  outqueue.setLimit (l3->queuelimit);
   pth_sem_init (&sem);
   init_ok = false;
   if (!write_only)
-    if (!layer3->registerGroupCallBack (this, 0))
+    if (!layer3->registerGroupCallBack (this, 0, f))
       return;
   init_ok = true;
 }
@@ -648,11 +682,34 @@ GroupSocket::Get_L_Data (L_Data_PDU * l)
       c.data = t1->data;
       c.src = l->source;
       c.dst = l->dest;
-      outqueue.put (c);
-      pth_sem_inc (&sem, 0);
+      if (!outqueue.full ())
+	{
+	  outqueue.put (c);
+	  pth_sem_inc (&sem, 0);
+	}
+      else
+	Overflow (c);
     }
   delete t;
-  delete l;
+  l->unref ();
+}
+
+void
+GroupSocket::Overflow (const GroupAPDU & c)
+{
+  clientdropped.inc ();
+  if (outqueue.overflow ())
+    {
+      outqueue.get ();
+      outqueue.put (c);
+    }
+  TRACEPRINTF (t, 4, this, "GroupSocket queue full, %lu dropped",
+	       outqueue.dropped);
+  if (outqueue.disconnect && oc)
+    {
+      oc->Overflow ();
+      oc = 0;
+    }
 }
 
 void
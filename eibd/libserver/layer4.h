@@ -86,6 +86,14 @@ public:
   void Send (const CArray & c);
 };
 
+/** notification about a receive queue overflow with policy Overflow_Disconnect */
+class Overflow_CallBack
+{
+public:
+  /** called, when the consumer must be disconnected */
+  virtual void Overflow () = 0;
+};
+
 /** Group Communication socket */
 class GroupSocket:public L_Data_CallBack
 {
@@ -94,13 +102,18 @@ class GroupSocket:public L_Data_CallBack
   /** debug output */
   Trace *t;
   /** output queue */
-    Queue < GroupAPDU > outqueue;
+    BoundedQueue < GroupAPDU > outqueue;
+  /** overflow notification */
+  Overflow_CallBack *oc;
     /** semaphore for output queue */
   pth_sem_t sem;
   bool init_ok;
 
+  /** handles an APDU, which does not fit into the queue */
+  void Overflow (const GroupAPDU & c);
 public:
-    GroupSocket (Layer3 * l3, Trace * t, int write_only);
+    GroupSocket (Layer3 * l3, Trace * t, int write_only,
+		 Overflow_CallBack * oc = 0, const FrameFilter * f = 0);
     virtual ~ GroupSocket ();
   bool init ();
 
@@ -108,6 +121,11 @@ public:
 
   /** receives APDU of a broadcast; aborts with NULL if stop occurs */
   GroupAPDU *Get (pth_event_t stop);
+  /** returns the number of APDUs dropped because of a full queue */
+  unsigned long dropped () const
+  {
+    return outqueue.dropped;
+  }
   /** send APDU c */
   void Send (const GroupAPDU & c);
 };
@@ -120,15 +138,21 @@ class T_Group:public L_Data_CallBack
   /** debug output */
   Trace *t;
   /** output queue */
-    Queue < GroupComm > outqueue;
+    BoundedQueue < GroupComm > outqueue;
+  /** overflow notification */
+  Overflow_CallBack *oc;
     /** semaphore for output queue */
   pth_sem_t sem;
   /** group address */
   eibaddr_t groupaddr;
   bool init_ok;
 
+  /** handles an APDU, which does not fit into the queue */
+  void Overflow (const GroupComm & c);
+
 public:
-    T_Group (Layer3 * l3, Trace * t, eibaddr_t dest, int write_only);
+    T_Group (Layer3 * l3, Trace * t, eibaddr_t dest, int write_only,
+	     Overflow_CallBack * oc = 0);
     virtual ~ T_Group ();
   bool init ();
 
@@ -136,6 +160,11 @@ public:
 
   /** receives APDU of a group telegram; aborts with NULL if stop occurs */
   GroupComm *Get (pth_event_t stop);
+  /** returns the number of APDUs dropped because of a full queue */
+  unsigned long dropped () const
+  {
+    return outqueue.dropped;
+  }
   /** send APDU c */
   void Send (const CArray & c);
 };
@@ -57,7 +57,6 @@ Array < eibaddr_t >
 {
   Array < eibaddr_t > addrs;
   A_IndividualAddress_Read_PDU r;
-  APDU *a;
   l4->Send (r.ToPacket ());
   pth_event_t t = pth_event (PTH_EVENT_RTIME, pth_time (timeout, 0));
   while (pth_event_status (t) != PTH_STATUS_OCCURRED)
@@ -65,13 +64,12 @@ Array < eibaddr_t >
       BroadcastComm *c = l4->Get (t);
       if (c)
 	{
-	  a = APDU::fromPacket (c->data);
-	  if (a->isResponse (&r))
+	  APDU_View a;
+	  if (a.init (c->data) && a.type == A_IndividualAddress_Response)
 	    {
 	      addrs.resize (addrs () + 1);
 	      addrs[addrs () - 1] = c->src;
 	    }
-	  delete a;
 	  delete c;
 	}
     }
@@ -127,6 +125,14 @@ Layer7_Connection::Request_Response (APDU * r)
 	      pth_event_free (t, PTH_FREE_THIS);
 	      return 0;
 	    }
+	  APDU_View v;
+	  if (!v.init (*c))
+	    {
+	      /* no response, without building an APDU object */
+	      delete c;
+	      pth_event_free (t, PTH_FREE_THIS);
+	      return 0;
+	    }
 	  a = APDU::fromPacket (*c);
 	  delete c;
 	  if (a->isResponse (r))
@@ -428,6 +434,14 @@ Layer7_Individual::Request_Response (APDU * r)
 	      pth_event_free (t, PTH_FREE_THIS);
 	      return 0;
 	    }
+	  APDU_View v;
+	  if (!v.init (*c))
+	    {
+	      /* no response, without building an APDU object */
+	      delete c;
+	      pth_event_free (t, PTH_FREE_THIS);
+	      return 0;
+	    }
 	  a = APDU::fromPacket (*c);
 	  delete c;
 	  if (a->isResponse (r))
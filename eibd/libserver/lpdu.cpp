@@ -21,6 +21,8 @@
 #include "lpdu.h"
 #include "tpdu.h"
 
+unsigned long LPDU::allocations = 0;
+
 LPDU *
 LPDU::fromPacket (const CArray & c)
 {
@@ -208,6 +210,7 @@ L_Data_PDU::L_Data_PDU ()
   source = 0;
   dest = 0;
   hopcount = 0x07;
+  route = L_Route_None;
 }
 
 bool
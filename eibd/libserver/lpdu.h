@@ -43,17 +43,54 @@ typedef enum
 }
 LPDU_Type;
 
-/** represents a Layer 2 frame */
+/** represents a Layer 2 frame
+ * frames delivered by Layer 3 are shared between all receivers and
+ * must not be modified; they are released with unref
+ */
 class LPDU
 {
+  /** reference count */
+  unsigned refcount;
 public:
+  /** number of frames created so far */
+  static unsigned long allocations;
+
   LPDU ()
   {
     object = 0;
+    arrival = 0;
+    refcount = 1;
+    allocations++;
+  }
+  LPDU (const LPDU & l)
+  {
+    object = l.object;
+    arrival = l.arrival;
+    refcount = 1;
+    allocations++;
   }
   virtual ~ LPDU ()
   {
   }
+  /** assignment operator, does not copy the reference count */
+  const LPDU & operator = (const LPDU & l)
+  {
+    object = l.object;
+    arrival = l.arrival;
+    return *this;
+  }
+
+  /** takes an additional reference to the frame */
+  void ref ()
+  {
+    refcount++;
+  }
+  /** drops a reference; the frame is deleted with the last one */
+  void unref ()
+  {
+    if (!--refcount)
+      delete this;
+  }
 
   virtual bool init (const CArray & c) = 0;
   /** convert to a character array */
@@ -66,6 +103,8 @@ public:
   static LPDU *fromPacket (const CArray & c);
 
   void *object;
+  /** time of the arrival in eibd (getMonotonicTime), 0 if unknown */
+  timestamp_t arrival;
 };
 
 /* L_Unknown */
@@ -89,6 +128,17 @@ public:
 
 /* L_Data */
 
+/** routing state of a L_Data frame, which Layer 3 passed to a backend */
+typedef enum
+{
+  /** not sent by Layer 3 (received from the bus) */
+  L_Route_None,
+  /** sent for a local client, the echo is only delivered locally */
+  L_Route_Local,
+  /** additional copy for an other line, the echo is discarded */
+  L_Route_Copy,
+} L_Data_Route;
+
 class L_Data_PDU:public LPDU
 {
 public:
@@ -104,6 +154,8 @@ public:
   EIB_AddrType AddrType;
   eibaddr_t source, dest;
   uchar hopcount;
+  /** routing state */
+  L_Data_Route route;
   /** payload of Layer 4 */
   CArray data;
 
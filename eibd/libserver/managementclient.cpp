@@ -196,17 +196,332 @@ WriteIndividualAddress (Layer3 * l3, Trace * t, ClientConnection * c,
   c->sendreject (stop, EIB_M_INDIVIDUAL_ADDRESS_WRITE);
 }
 
-void
-ManagementConnection (Layer3 * l3, Trace * t, ClientConnection * c,
-		      pth_event_t stop)
+/** sets erg to an answer without data
+ * @param erg answer
+ * @param type message type
+ */
+static void
+answer (CArray & erg, int type)
+{
+  erg.resize (2);
+  EIBSETTYPE (erg, type);
+}
+
+/** sends the answer to the current request of a management session;
+ * answers to tagged requests (EIB_MC_TAGGED) are tagged in the same way;
+ * each answer is sent at once, as the next request may wait for the bus
+ * @param c client connection
+ * @param erg answer
+ * @param stop if occurs, function should abort
+ */
+static int
+sendanswer (ClientConnection * c, const CArray & erg, pth_event_t stop)
+{
+  if (EIBTYPE (c->buf) != EIB_MC_TAGGED || c->size < 6)
+    return c->sendmessage (erg (), erg.array (), stop);
+
+  CArray tagged;
+  tagged.resize (4);
+  EIBSETTYPE (tagged, EIB_MC_TAGGED);
+  tagged[2] = c->buf[2];
+  tagged[3] = c->buf[3];
+  tagged.setpart (erg, 4);
+  return c->sendmessage (tagged (), tagged.array (), stop);
+}
+
+/** executes a request of a management connection
+ * @param m management connection
+ * @param req request
+ * @param size length of req
+ * @param erg answer
+ */
+static void
+ConnectionRequest (Management_Connection & m, uchar * req,
+		   unsigned size, CArray & erg)
 {
-  eibaddr_t dest;
   uint16_t maskver;
   int16_t val;
   uchar buf[10];
   int i;
   eibkey_type key;
 
+  switch (EIBTYPE (req))
+    {
+    case EIB_MC_PROG_MODE:
+      if (size < 3)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      EIBSETTYPE (buf, EIB_MC_PROG_MODE);
+      buf[2] = 0;
+      switch (req[2])
+	{
+	case 0:
+	  if (m.X_Progmode_Off () == -1)
+	    answer (erg, EIB_INVALID_REQUEST);
+	  else
+	    erg.set (buf, 3);
+	  break;
+	case 1:
+	  if (m.X_Progmode_On () == -1)
+	    answer (erg, EIB_INVALID_REQUEST);
+	  else
+	    erg.set (buf, 3);
+	  break;
+	case 2:
+	  if (m.X_Progmode_Toggle () == -1)
+	    answer (erg, EIB_INVALID_REQUEST);
+	  else
+	    erg.set (buf, 3);
+	  break;
+	case 3:
+	  if ((i = m.X_Progmode_Status ()) == -1)
+	    answer (erg, EIB_INVALID_REQUEST);
+	  else
+	    {
+	      buf[2] = i;
+	      erg.set (buf, 3);
+	    }
+	  break;
+	default:
+	  answer (erg, EIB_INVALID_REQUEST);
+	}
+      break;
+    case EIB_MC_MASK_VERSION:
+      if (m.A_Device_Descriptor_Read (maskver) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	{
+	  EIBSETTYPE (buf, EIB_MC_MASK_VERSION);
+	  buf[2] = (maskver >> 8) & 0xff;
+	  buf[3] = (maskver) & 0xff;
+	  erg.set (buf, 4);
+	}
+      break;
+    case EIB_MC_PEI_TYPE:
+      if (m.X_Get_PEIType (val) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	{
+	  EIBSETTYPE (buf, EIB_MC_PEI_TYPE);
+	  buf[2] = (val >> 8) & 0xff;
+	  buf[3] = (val) & 0xff;
+	  erg.set (buf, 4);
+	}
+      break;
+    case EIB_MC_ADC_READ:
+      if (size < 4)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      if (m.A_ADC_Read (req[2], req[3], val) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	{
+	  EIBSETTYPE (buf, EIB_MC_ADC_READ);
+	  buf[2] = (val >> 8) & 0xff;
+	  buf[3] = (val) & 0xff;
+	  erg.set (buf, 4);
+	}
+      break;
+
+    case EIB_MC_READ:
+      if (size < 6)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	memaddr_t addr = (req[2] << 8) | (req[3]);
+	unsigned len = (req[4] << 8) | (req[5]);
+	CArray data;
+	if (m.X_Memory_Read_Block (addr, len, data) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (6);
+	    EIBSETTYPE (erg, EIB_MC_READ);
+	    erg.setpart (data, 2);
+	  }
+      }
+      break;
+
+    case EIB_MC_WRITE:
+      if (size < 6)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	memaddr_t addr = (req[2] << 8) | (req[3]);
+	unsigned len = (req[4] << 8) | (req[5]);
+	if (size < len + 6)
+	  {
+	    answer (erg, EIB_INVALID_REQUEST);
+	    break;
+	  }
+	i = m.X_Memory_Write_Block (addr, CArray (req + 6, len));
+	if (i == -2)
+	  answer (erg, EIB_ERROR_VERIFY);
+	else if (i != 0)
+	  answer (erg, EIB_PROCESSING_ERROR);
+	else
+	  answer (erg, EIB_MC_WRITE);
+      }
+      break;
+
+    case EIB_MC_PROP_READ:
+      if (size < 7)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	CArray data;
+	if (m.A_Property_Read (req[2], req[3],
+			       (req[4] << 8) | req[5], req[6],
+			       data) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (2);
+	    EIBSETTYPE (erg, EIB_MC_PROP_READ);
+	    erg.setpart (data, 2);
+	  }
+      }
+      break;
+
+    case EIB_MC_PROP_WRITE:
+      if (size < 7)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	CArray data;
+	if (m.A_Property_Write (req[2], req[3],
+				(req[4] << 8) | req[5], req[6],
+				CArray (req + 7, size - 7),
+				erg) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (2);
+	    EIBSETTYPE (erg, EIB_MC_PROP_WRITE);
+	    erg.setpart (data, 2);
+	  }
+      }
+      break;
+
+    case EIB_MC_AUTHORIZE:
+      if (size < 6)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      EIBSETTYPE (buf, EIB_MC_AUTHORIZE);
+      key = (req[2] << 24) | (req[3] << 16) | (req[4] << 8) | (req[5]);
+      if (m.A_Authorize (key, buf[2]) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	erg.set (buf, 3);
+      break;
+
+    case EIB_MC_KEY_WRITE:
+      if (size < 7)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      key = (req[2] << 24) | (req[3] << 16) | (req[4] << 8) | (req[5]);
+      if (m.A_KeyWrite (key, *(req + 6)) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	answer (erg, EIB_MC_KEY_WRITE);
+      break;
+
+    case EIB_MC_PROP_DESC:
+      if (size < 4)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      if (m.A_Property_Desc (req[2], req[3], 0, buf[2], maskver,
+			     buf[5]) == -1)
+	answer (erg, EIB_INVALID_REQUEST);
+      else
+	{
+	  EIBSETTYPE (buf, EIB_MC_PROP_DESC);
+	  buf[3] = (maskver >> 8) & 0xff;
+	  buf[4] = (maskver) & 0xff;
+	  erg.set (buf, 6);
+	}
+      break;
+
+    case EIB_MC_PROP_SCAN:
+      {
+	Array < PropertyInfo > p;
+	if (m.X_PropertyScan (p) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (2 + p () * 6);
+	    EIBSETTYPE (erg, EIB_MC_PROP_SCAN);
+	    for (unsigned i = 0; i < p (); i++)
+	      {
+		erg[i * 6 + 2] = p[i].obj;
+		erg[i * 6 + 3] = p[i].property;
+		erg[i * 6 + 4] = p[i].type;
+		erg[i * 6 + 5] = (p[i].count >> 8) & 0xff;
+		erg[i * 6 + 6] = (p[i].count) & 0xff;
+		erg[i * 6 + 7] = p[i].access;
+	      }
+	  }
+      }
+      break;
+
+    case EIB_MC_RESTART:
+      m.A_Restart ();
+      answer (erg, EIB_MC_RESTART);
+      break;
+
+    case EIB_MC_WRITE_NOVERIFY:
+      if (size < 6)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	memaddr_t addr = (req[2] << 8) | (req[3]);
+	unsigned len = (req[4] << 8) | (req[5]);
+	if (size < len + 6)
+	  {
+	    answer (erg, EIB_INVALID_REQUEST);
+	    break;
+	  }
+	i = m.A_Memory_Write_Block (addr, CArray (req + 6, len));
+	if (i != 0)
+	  answer (erg, EIB_PROCESSING_ERROR);
+	else
+	  answer (erg, EIB_MC_WRITE_NOVERIFY);
+      }
+      break;
+
+    default:
+      answer (erg, EIB_INVALID_REQUEST);
+    }
+
+}
+
+void
+ManagementConnection (Layer3 * l3, Trace * t, ClientConnection * c,
+		      pth_event_t stop)
+{
+  eibaddr_t dest;
+  uint16_t maskver;
+
   if (c->size < 4)
     {
       c->sendreject (stop);
@@ -226,292 +541,78 @@ ManagementConnection (Layer3 * l3, Trace * t, ClientConnection * c,
       return;
     }
   c->sendreject (stop, EIB_MC_CONNECTION);
-  do
+  while (c->readmessage (stop) != -1)
     {
-      i = c->readmessage (stop);
-      if (i != -1)
-	switch (EIBTYPE (c->buf))
-	  {
-	  case EIB_MC_PROG_MODE:
-	    if (c->size < 3)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    EIBSETTYPE (buf, EIB_MC_PROG_MODE);
-	    buf[2] = 0;
-	    switch (c->buf[2])
-	      {
-	      case 0:
-		if (m.X_Progmode_Off () == -1)
-		  c->sendreject (stop);
-		else
-		  c->sendmessage (3, buf, stop);
-		break;
-	      case 1:
-		if (m.X_Progmode_On () == -1)
-		  c->sendreject (stop);
-		else
-		  c->sendmessage (3, buf, stop);
-		break;
-	      case 2:
-		if (m.X_Progmode_Toggle () == -1)
-		  c->sendreject (stop);
-		else
-		  c->sendmessage (3, buf, stop);
-		break;
-	      case 3:
-		if ((i = m.X_Progmode_Status ()) == -1)
-		  c->sendreject (stop);
-		else
-		  {
-		    buf[2] = i;
-		    c->sendmessage (3, buf, stop);
-		  }
-		break;
-	      default:
-		c->sendreject (stop);
-	      }
-	    break;
-	  case EIB_MC_MASK_VERSION:
-	    if (m.A_Device_Descriptor_Read (maskver) == -1)
-	      c->sendreject (stop);
-	    else
-	      {
-		EIBSETTYPE (buf, EIB_MC_MASK_VERSION);
-		buf[2] = (maskver >> 8) & 0xff;
-		buf[3] = (maskver) & 0xff;
-		c->sendmessage (4, buf, stop);
-	      }
-	    break;
-	  case EIB_MC_PEI_TYPE:
-	    if (m.X_Get_PEIType (val) == -1)
-	      c->sendreject (stop);
-	    else
-	      {
-		EIBSETTYPE (buf, EIB_MC_PEI_TYPE);
-		buf[2] = (val >> 8) & 0xff;
-		buf[3] = (val) & 0xff;
-		c->sendmessage (4, buf, stop);
-	      }
-	    break;
-	  case EIB_MC_ADC_READ:
-	    if (c->size < 4)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    if (m.A_ADC_Read (c->buf[2], c->buf[3], val) == -1)
-	      c->sendreject (stop);
-	    else
-	      {
-		EIBSETTYPE (buf, EIB_MC_ADC_READ);
-		buf[2] = (val >> 8) & 0xff;
-		buf[3] = (val) & 0xff;
-		c->sendmessage (4, buf, stop);
-	      }
-	    break;
-
-	  case EIB_MC_READ:
-	    if (c->size < 6)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      memaddr_t addr = (c->buf[2] << 8) | (c->buf[3]);
-	      unsigned len = (c->buf[4] << 8) | (c->buf[5]);
-	      CArray data, erg;
-	      if (m.X_Memory_Read_Block (addr, len, data) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  erg.resize (6);
-		  EIBSETTYPE (erg, EIB_MC_READ);
-		  erg.setpart (data, 2);
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_MC_WRITE:
-	    if (c->size < 6)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      memaddr_t addr = (c->buf[2] << 8) | (c->buf[3]);
-	      unsigned len = (c->buf[4] << 8) | (c->buf[5]);
-	      if (c->size < len + 6)
-		{
-		  c->sendreject (stop);
-		  break;
-		}
-	      i = m.X_Memory_Write_Block (addr, CArray (c->buf + 6, len));
-	      if (i == -2)
-		c->sendreject (stop, EIB_ERROR_VERIFY);
-	      else if (i != 0)
-		c->sendreject (stop, EIB_PROCESSING_ERROR);
-	      else
-		c->sendreject (stop, EIB_MC_WRITE);
-	    }
-	    break;
-
-	  case EIB_MC_PROP_READ:
-	    if (c->size < 7)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      CArray data, erg;
-	      if (m.A_Property_Read (c->buf[2], c->buf[3],
-				     (c->buf[4] << 8) | c->buf[5], c->buf[6],
-				     data) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  erg.resize (2);
-		  EIBSETTYPE (erg, EIB_MC_PROP_READ);
-		  erg.setpart (data, 2);
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_MC_PROP_WRITE:
-	    if (c->size < 7)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      CArray data, erg;
-	      if (m.A_Property_Write (c->buf[2], c->buf[3],
-				      (c->buf[4] << 8) | c->buf[5], c->buf[6],
-				      CArray (c->buf + 7, c->size - 7),
-				      erg) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  erg.resize (2);
-		  EIBSETTYPE (erg, EIB_MC_PROP_WRITE);
-		  erg.setpart (data, 2);
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_MC_AUTHORIZE:
-	    if (c->size < 6)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    EIBSETTYPE (buf, EIB_MC_AUTHORIZE);
-	    key =
-	      (c->buf[2] << 24) | (c->buf[3] << 16) | (c->buf[4] << 8) |
-	      (c->buf[5]);
-	    if (m.A_Authorize (key, buf[2]) == -1)
-	      c->sendreject (stop);
-	    else
-	      c->sendmessage (3, buf, stop);
-	    break;
-
-	  case EIB_MC_KEY_WRITE:
-	    if (c->size < 7)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    key =
-	      (c->buf[2] << 24) | (c->buf[3] << 16) | (c->buf[4] << 8) |
-	      (c->buf[5]);
-	    if (m.A_KeyWrite (key, *(c->buf + 6)) == -1)
-	      c->sendreject (stop);
-	    else
-	      c->sendreject (stop, EIB_MC_KEY_WRITE);
-	    break;
-
-	  case EIB_MC_PROP_DESC:
-	    if (c->size < 4)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    if (m.A_Property_Desc (c->buf[2], c->buf[3], 0, buf[2], maskver,
-				   buf[5]) == -1)
-	      c->sendreject (stop);
-	    else
-	      {
-		EIBSETTYPE (buf, EIB_MC_PROP_DESC);
-		buf[3] = (maskver >> 8) & 0xff;
-		buf[4] = (maskver) & 0xff;
-		c->sendmessage (6, buf, stop);
-	      }
-	    break;
-
-	  case EIB_MC_PROP_SCAN:
-	    {
-	      Array < PropertyInfo > p;
-	      if (m.X_PropertyScan (p) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  CArray erg;
-		  erg.resize (2 + p () * 6);
-		  EIBSETTYPE (erg, EIB_MC_PROP_SCAN);
-		  for (unsigned i = 0; i < p (); i++)
-		    {
-		      erg[i * 6 + 2] = p[i].obj;
-		      erg[i * 6 + 3] = p[i].property;
-		      erg[i * 6 + 4] = p[i].type;
-		      erg[i * 6 + 5] = (p[i].count >> 8) & 0xff;
-		      erg[i * 6 + 6] = (p[i].count) & 0xff;
-		      erg[i * 6 + 7] = p[i].access;
-		    }
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_RESET_CONNECTION:
-	    i = -1;
-	    break;
-
-	  case EIB_MC_RESTART:
-	    m.A_Restart ();
-	    c->sendreject (stop, EIB_MC_RESTART);
-	    break;
+      CArray erg;
+      if (EIBTYPE (c->buf) == EIB_RESET_CONNECTION)
+	break;
+      if (EIBTYPE (c->buf) == EIB_MC_TAGGED && c->size >= 6)
+	ConnectionRequest (m, c->buf + 4, c->size - 4, erg);
+      else
+	ConnectionRequest (m, c->buf, c->size, erg);
+      if (sendanswer (c, erg, stop) == -1)
+	break;
+    }
+}
 
-	  case EIB_MC_WRITE_NOVERIFY:
-	    if (c->size < 6)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      memaddr_t addr = (c->buf[2] << 8) | (c->buf[3]);
-	      unsigned len = (c->buf[4] << 8) | (c->buf[5]);
-	      if (c->size < len + 6)
-		{
-		  c->sendreject (stop);
-		  break;
-		}
-	      i = m.A_Memory_Write_Block (addr, CArray (c->buf + 6, len));
-	      if (i != 0)
-		c->sendreject (stop, EIB_PROCESSING_ERROR);
-	      else
-		c->sendreject (stop, EIB_MC_WRITE_NOVERIFY);
-	    }
-	    break;
+/** executes a request of an individual connection
+ * @param m individual connection
+ * @param req request
+ * @param size length of req
+ * @param erg answer
+ */
+static void
+IndividualRequest (Management_Individual & m, uchar * req,
+		   unsigned size, CArray & erg)
+{
+  switch (EIBTYPE (req))
+    {
+    case EIB_MC_PROP_READ:
+      if (size < 7)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	CArray data;
+	if (m.A_Property_Read (req[2], req[3],
+			       (req[4] << 8) | req[5], req[6],
+			       data) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (2);
+	    EIBSETTYPE (erg, EIB_MC_PROP_READ);
+	    erg.setpart (data, 2);
+	  }
+      }
+      break;
 
-	  default:
-	    c->sendreject (stop);
+    case EIB_MC_PROP_WRITE:
+      if (size < 7)
+	{
+	  answer (erg, EIB_INVALID_REQUEST);
+	  break;
+	}
+      {
+	CArray data;
+	if (m.A_Property_Write (req[2], req[3],
+				(req[4] << 8) | req[5], req[6],
+				CArray (req + 7, size - 7),
+				erg) == -1)
+	  answer (erg, EIB_INVALID_REQUEST);
+	else
+	  {
+	    erg.resize (2);
+	    EIBSETTYPE (erg, EIB_MC_PROP_WRITE);
+	    erg.setpart (data, 2);
 	  }
+      }
+      break;
+
+    default:
+      answer (erg, EIB_INVALID_REQUEST);
     }
-  while (i != -1);
 }
 
 void
@@ -519,7 +620,6 @@ ManagementIndividual (Layer3 * l3, Trace * t, ClientConnection * c,
 		      pth_event_t stop)
 {
   eibaddr_t dest;
-  int i;
 
   if (c->size < 4)
     {
@@ -535,66 +635,18 @@ ManagementIndividual (Layer3 * l3, Trace * t, ClientConnection * c,
       return;
     }
   c->sendreject (stop, EIB_MC_INDIVIDUAL);
-  do
+  while (c->readmessage (stop) != -1)
     {
-      i = c->readmessage (stop);
-      if (i != -1)
-	switch (EIBTYPE (c->buf))
-	  {
-	  case EIB_MC_PROP_READ:
-	    if (c->size < 7)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      CArray data, erg;
-	      if (m.A_Property_Read (c->buf[2], c->buf[3],
-				     (c->buf[4] << 8) | c->buf[5], c->buf[6],
-				     data) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  erg.resize (2);
-		  EIBSETTYPE (erg, EIB_MC_PROP_READ);
-		  erg.setpart (data, 2);
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_MC_PROP_WRITE:
-	    if (c->size < 7)
-	      {
-		c->sendreject (stop);
-		break;
-	      }
-	    {
-	      CArray data, erg;
-	      if (m.A_Property_Write (c->buf[2], c->buf[3],
-				      (c->buf[4] << 8) | c->buf[5], c->buf[6],
-				      CArray (c->buf + 7, c->size - 7),
-				      erg) == -1)
-		c->sendreject (stop);
-	      else
-		{
-		  erg.resize (2);
-		  EIBSETTYPE (erg, EIB_MC_PROP_WRITE);
-		  erg.setpart (data, 2);
-		  c->sendmessage (erg (), erg.array (), stop);
-		}
-	    }
-	    break;
-
-	  case EIB_RESET_CONNECTION:
-	    i = -1;
-	    break;
-
-	  default:
-	    c->sendreject (stop);
-	  }
+      CArray erg;
+      if (EIBTYPE (c->buf) == EIB_RESET_CONNECTION)
+	break;
+      if (EIBTYPE (c->buf) == EIB_MC_TAGGED && c->size >= 6)
+	IndividualRequest (m, c->buf + 4, c->size - 4, erg);
+      else
+	IndividualRequest (m, c->buf, c->size, erg);
+      if (sendanswer (c, erg, stop) == -1)
+	break;
     }
-  while (i != -1);
 }
 
 void
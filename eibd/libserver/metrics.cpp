@@ -0,0 +1,121 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include "metrics.h"
+
+Metric *Metric::first = 0;
+
+Metric::Metric (const char *n)
+{
+  prev = 0;
+  next = 0;
+  if (n)
+    setName ("%s", n);
+}
+
+Metric::~Metric ()
+{
+  if (!name ())
+    return;
+  if (prev)
+    prev->next = next;
+  else
+    first = next;
+  if (next)
+    next->prev = prev;
+}
+
+void
+Metric::setName (const char *fmt, ...)
+{
+  char buf[200];
+  va_list ap;
+  va_start (ap, fmt);
+  vsnprintf (buf, sizeof (buf), fmt, ap);
+  va_end (ap);
+  if (!name ())
+    {
+      prev = 0;
+      next = first;
+      if (first)
+	first->prev = this;
+      first = this;
+    }
+  name = buf;
+}
+
+void
+Metric::line (CArray & out, const char *fmt, ...)
+{
+  char buf[200];
+  va_list ap;
+  va_start (ap, fmt);
+  int l = vsnprintf (buf, sizeof (buf), fmt, ap);
+  va_end (ap);
+  if (l < 0)
+    return;
+  if (l >= (int) sizeof (buf))
+    l = sizeof (buf) - 1;
+  out.setpart ((uchar *) buf, out (), l);
+}
+
+void
+Metric::Dump (CArray & out, const char *prefix)
+{
+  unsigned l = strlen (prefix);
+  for (Metric * m = first; m; m = m->next)
+    if (!strncmp (m->name (), prefix, l))
+      m->format (out, m->name ());
+}
+
+void
+Counter::format (CArray & out, const char *name) const
+{
+  line (out, "%s %" PRIu64 "\n", name, value);
+}
+
+void
+Gauge::format (CArray & out, const char *name) const
+{
+  line (out, "%s %" PRId64 "\n", name, value);
+}
+
+Histogram::Histogram (const char *name):Metric (name)
+{
+  count = 0;
+  sum = 0;
+  memset (buckets, 0, sizeof (buckets));
+}
+
+void
+Histogram::format (CArray & out, const char *name) const
+{
+  unsigned i, last = 0;
+  line (out, "%s.count %" PRIu64 "\n", name, count);
+  line (out, "%s.sum_us %" PRIu64 "\n", name, sum);
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+    if (buckets[i])
+      last = i;
+  for (i = 0; i <= last; i++)
+    line (out, "%s.lt_%" PRIu64 "us %" PRIu64 "\n", name,
+	  (uint64_t) 1 << i, buckets[i]);
+}
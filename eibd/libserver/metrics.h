@@ -0,0 +1,135 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+/** number of buckets of a histogram */
+#define HISTOGRAM_BUCKETS 32
+
+/** base of all runtime metrics
+ *
+ * Each named metric is registered in a global list while it exists,
+ * from which Dump creates a text report. Updating a metric is a plain
+ * increment; pth runs all threads on one OS thread, so no locking is
+ * needed.
+ */
+class Metric
+{
+  /** name, empty if unregistered */
+  String name;
+  /** neighbours in the registry */
+  Metric *prev, *next;
+  /** first registered metric */
+  static Metric *first;
+
+protected:
+  /** appends the value lines to out */
+  virtual void format (CArray & out, const char *name) const = 0;
+  /** appends a line to out */
+  static void line (CArray & out, const char *fmt, ...);
+
+public:
+  /** creates a metric; it is only registered, if name is not 0 */
+  Metric (const char *name);
+  virtual ~ Metric ();
+  /** registers the metric with a printf like name */
+  void setName (const char *fmt, ...);
+
+  /** appends a text report of all metrics, whose names start with
+   * prefix, to out; each line has the form "name value" */
+  static void Dump (CArray & out, const char *prefix = "");
+};
+
+/** a monotonic increasing count */
+class Counter:public Metric
+{
+  void format (CArray & out, const char *name) const;
+public:
+  uint64_t value;
+
+  Counter (const char *name = 0):Metric (name)
+  {
+    value = 0;
+  }
+  void inc ()
+  {
+    value++;
+  }
+  void add (unsigned n)
+  {
+    value += n;
+  }
+};
+
+/** a value, which can go up and down */
+class Gauge:public Metric
+{
+  void format (CArray & out, const char *name) const;
+public:
+  int64_t value;
+
+  Gauge (const char *name = 0):Metric (name)
+  {
+    value = 0;
+  }
+  void set (int64_t v)
+  {
+    value = v;
+  }
+  void inc ()
+  {
+    value++;
+  }
+  void dec ()
+  {
+    value--;
+  }
+};
+
+/** distribution of durations in us; bucket i counts the values
+ * below 2^i us, which are not counted by a lower bucket */
+class Histogram:public Metric
+{
+  void format (CArray & out, const char *name) const;
+public:
+  uint64_t count;
+  uint64_t sum;
+  uint64_t buckets[HISTOGRAM_BUCKETS];
+
+  Histogram (const char *name = 0);
+  void add (uint64_t us)
+  {
+    unsigned b = (us ? 64 - __builtin_clzll (us) : 0);
+    if (b >= HISTOGRAM_BUCKETS)
+      b = HISTOGRAM_BUCKETS - 1;
+    buckets[b]++;
+    count++;
+    sum += us;
+  }
+  /** adds the time since start (from getMonotonicTime) */
+  void since (timestamp_t start)
+  {
+    add ((getMonotonicTime () - start) / 1000);
+  }
+};
+
+#endif
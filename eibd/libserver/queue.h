@@ -20,7 +20,17 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
-/** implement a generic FIFO queue*/
+/** number of unused entries, a queue keeps for reuse at least */
+#define QUEUE_SPARE 16
+/** maximum number of entries, which BoundedQueue::setLimit allocates
+ * in advance */
+#define QUEUE_RESERVE_MAX 256
+
+/** implement a generic FIFO queue
+ *
+ * Removed entries are kept on a free list and reused by put, so a queue
+ * in steady state does not call the allocator.
+ */
 template < class T > class Queue
 {
 protected:
@@ -37,22 +47,72 @@ protected:
   Entry *akt;
   /** pointer where to store the pointer to the next element */
   Entry **head;
+  /** number of elements */
+  unsigned count;
+  /** unused entries */
+  Entry *spare;
+  /** number of unused entries */
+  unsigned sparecount;
+  /** maximum number of unused entries */
+  unsigned sparemax;
+
+  /** returns an unused entry */
+  Entry *alloc ()
+  {
+    if (!spare)
+      return new Entry;
+    Entry *e = spare;
+    spare = e->Next;
+    sparecount--;
+    return e;
+  }
+
+  /** puts an entry on the free list or frees it, if the list is full */
+  void release (Entry * e)
+  {
+    if (sparecount >= sparemax)
+      {
+	delete e;
+	return;
+      }
+    e->Next = spare;
+    spare = e;
+    sparecount++;
+  }
+
+  void init ()
+  {
+    akt = 0;
+    head = &akt;
+    count = 0;
+    spare = 0;
+    sparecount = 0;
+    sparemax = QUEUE_SPARE;
+  }
 
 public:
 
   /** initialize queue */
   Queue ()
   {
-    akt = 0;
-    head = &akt;
+    init ();
+  }
+
+  /** initialize queue
+   * @param hint expected number of elements, for which entries are
+   * allocated in advance
+   */
+  Queue (unsigned hint)
+  {
+    init ();
+    reserve (hint);
   }
 
   /** copy constructer */
   Queue (const Queue < T > &c)
   {
-    Entry *a = c->akt;
-    akt = 0;
-    head = &akt;
+    Entry *a = c.akt;
+    init ();
     while (a)
       {
 	put (a->entry);
@@ -65,6 +125,12 @@ public:
   {
     while (akt)
       get ();
+    while (spare)
+      {
+	Entry *e = spare;
+	spare = e->Next;
+	delete e;
+      }
   }
 
   /** assignment operator */
@@ -82,14 +148,25 @@ public:
     return *this;
   }
 
+  /** allocates entries for hint elements in advance and keeps them
+   * for reuse */
+  void reserve (unsigned hint)
+  {
+    if (hint > sparemax)
+      sparemax = hint;
+    while (count + sparecount < hint)
+      release (new Entry);
+  }
+
   /** adds a element to the queue end */
   void put (const T & el)
   {
-    Entry *elem = new Entry;
+    Entry *elem = alloc ();
     elem->Next = 0;
     elem->entry = el;
     *head = elem;
     head = &elem->Next;
+    count++;
   }
 
   /** remove the element from the queue head and returns it */
@@ -99,9 +176,10 @@ public:
     Entry *e = akt;
     T a = akt->entry;
     akt = akt->Next;
-    delete e;
+    release (e);
     if (!akt)
       head = &akt;
+    count--;
     return a;
   }
 
@@ -118,6 +196,87 @@ public:
     return akt == 0;
   }
 
+  /** returns the number of elements in the queue */
+  unsigned len () const
+  {
+    return count;
+  }
+
+};
+
+/** what to do, if an element is added to a full bounded queue */
+typedef enum
+{
+  /** remove the oldest element to make room for the new one */
+  Overflow_DropOldest,
+  /** discard the new element */
+  Overflow_DropNewest,
+  /** discard the new element and disconnect the consumer */
+  Overflow_Disconnect,
+} Overflow_Policy;
+
+/** size limit of a consumer queue */
+struct QueueLimit
+{
+  /** maximum number of queued elements; 0 means unlimited */
+  unsigned capacity;
+  /** overflow policy */
+  Overflow_Policy policy;
+
+  QueueLimit ()
+  {
+    capacity = 0;
+    policy = Overflow_DropOldest;
+  }
+};
+
+/** FIFO queue with a size limit, which counts the elements it dropped
+ *
+ * The queue does not enforce the limit itself, as dropping an element
+ * may require to release it or to adjust a semaphore. A producer checks
+ * full () before put and calls overflow () instead, if it returns true.
+ */
+template < class T > class BoundedQueue:public Queue < T >
+{
+public:
+  /** size limit */
+  QueueLimit limit;
+  /** number of dropped elements */
+  unsigned long dropped;
+  /** set, if the queue overflowed with policy Overflow_Disconnect */
+  bool disconnect;
+
+  BoundedQueue ()
+  {
+    dropped = 0;
+    disconnect = false;
+  }
+
+  /** sets the limit and allocates the entries for it in advance,
+   * at most QUEUE_RESERVE_MAX */
+  void setLimit (const QueueLimit & l)
+  {
+    limit = l;
+    this->reserve (l.capacity < QUEUE_RESERVE_MAX ? l.capacity :
+		   QUEUE_RESERVE_MAX);
+  }
+
+  /** returns true, if no further element may be added */
+  bool full () const
+  {
+    return limit.capacity && this->len () >= limit.capacity;
+  }
+
+  /** accounts a dropped element
+   * @return true, if the oldest element should be replaced by the new one
+   */
+  bool overflow ()
+  {
+    dropped++;
+    if (limit.policy == Overflow_Disconnect)
+      disconnect = true;
+    return limit.policy == Overflow_DropOldest;
+  }
 };
 
 #endif
@@ -0,0 +1,150 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "shmring.h"
+#include "eibtypes.h"
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_EVENTFD)
+#include <sys/eventfd.h>
+#endif
+
+ShmRing::ShmRing ()
+{
+  map = 0;
+  size = 0;
+  memfd = -1;
+  datafd = -1;
+  spacefd = -1;
+  head = 0;
+  pending = false;
+}
+
+ShmRing::~ShmRing ()
+{
+  if (map)
+    munmap (map, EIB_SHM_RING_HEADER + size);
+  if (memfd != -1)
+    ::close (memfd);
+  if (datafd != -1)
+    ::close (datafd);
+  if (spacefd != -1)
+    ::close (spacefd);
+}
+
+bool
+ShmRing::init (unsigned order)
+{
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_EVENTFD)
+  void *m;
+  if (order < EIB_SHM_RING_MIN_ORDER || order > EIB_SHM_RING_MAX_ORDER)
+    return false;
+  memfd = memfd_create ("eibd-ring", MFD_CLOEXEC);
+  if (memfd == -1)
+    return false;
+  if (ftruncate (memfd, EIB_SHM_RING_HEADER + (1 << order)) == -1)
+    return false;
+  m = mmap (0, EIB_SHM_RING_HEADER + (1 << order), PROT_READ | PROT_WRITE,
+	    MAP_SHARED, memfd, 0);
+  if (m == MAP_FAILED)
+    return false;
+  map = (uchar *) m;
+  size = 1 << order;
+  /* the pages of a new memfd are zero, so is the header */
+  datafd = eventfd (0, EFD_CLOEXEC);
+  spacefd = eventfd (0, EFD_CLOEXEC);
+  if (datafd == -1 || spacefd == -1)
+    return false;
+  return true;
+#else
+  return false;
+#endif
+}
+
+int
+ShmRing::wait (uint32_t need, pth_event_t stop)
+{
+  uint64_t v;
+  while (size - (head - field (EIB_SHM_RING_TAIL)) < need)
+    {
+      /* the client may sleep on records, which it has not seen yet */
+      pending = true;
+      signal ();
+      field (EIB_SHM_RING_FULL) = 1;
+      __sync_synchronize ();
+      if (size - (head - field (EIB_SHM_RING_TAIL)) >= need)
+	break;
+      if (pth_read_ev (spacefd, &v, sizeof (v), stop) != sizeof (v))
+	return -1;
+    }
+  __sync_synchronize ();
+  return 0;
+}
+
+int
+ShmRing::put (int len, const uchar * msg, pth_event_t stop)
+{
+  uint32_t need = 4 + ((len + 3) & ~3);
+  uint32_t off = head & (size - 1);
+  uint32_t wrap = 0;
+
+  if (off + need > size)
+    wrap = size - off;
+  if (wait (wrap + need, stop) == -1)
+    return -1;
+  if (wrap)
+    {
+      *(uint32_t *) (map + EIB_SHM_RING_HEADER + off) = EIB_SHM_RING_WRAP;
+      head += wrap;
+      off = 0;
+    }
+  *(uint32_t *) (map + EIB_SHM_RING_HEADER + off) = len;
+  memcpy (map + EIB_SHM_RING_HEADER + off + 4, msg, len);
+  head += need;
+  /* publish the record after its content */
+  __sync_synchronize ();
+  field (EIB_SHM_RING_HEAD) = head;
+  pending = true;
+  return 0;
+}
+
+void
+ShmRing::signal ()
+{
+  uint64_t v = 1;
+  if (!pending)
+    return;
+  pending = false;
+  __sync_synchronize ();
+  if (!field (EIB_SHM_RING_WAITING))
+    return;
+  field (EIB_SHM_RING_WAITING) = 0;
+  while (write (datafd, &v, sizeof (v)) == -1 && errno == EINTR)
+    ;
+}
+
+void
+ShmRing::close ()
+{
+  field (EIB_SHM_RING_CLOSED) = 1;
+  pending = true;
+  signal ();
+}
@@ -0,0 +1,86 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include "common.h"
+
+/** producer side of a shared memory ring (EIB_OPEN_SHM_RING)
+ *
+ * eibd writes the messages for a local client as records into a memfd,
+ * which is mapped by both. Two eventfds replace the socket for wakeups:
+ * one tells the client about new records, the other one tells eibd
+ * about freed space. Each side only signals, if the other one has
+ * announced to sleep, so a busy consumer causes no system calls.
+ */
+class ShmRing
+{
+  /** mapping of header and data area */
+  uchar *map;
+  /** size of the data area (power of 2) */
+  uint32_t size;
+  /** memfd of the mapping */
+  int memfd;
+  /** eventfd for new records */
+  int datafd;
+  /** eventfd for freed space */
+  int spacefd;
+  /** local copy of the write position */
+  uint32_t head;
+  /** records were added since the last signal */
+  bool pending;
+
+  /** accesses a field of the header */
+  volatile uint32_t & field (unsigned offset)
+  {
+    return *(volatile uint32_t *) (map + offset);
+  }
+  /** waits, until need bytes are free; aborts if stop occurs */
+  int wait (uint32_t need, pth_event_t stop);
+public:
+  ShmRing ();
+  ~ShmRing ();
+  /** creates a ring with a data area of 2^order bytes */
+  bool init (unsigned order);
+  /** returns the memfd, the client needs a copy of */
+  int getMemFD () const
+  {
+    return memfd;
+  }
+  /** returns the eventfd for new records */
+  int getDataFD () const
+  {
+    return datafd;
+  }
+  /** returns the eventfd for freed space */
+  int getSpaceFD () const
+  {
+    return spacefd;
+  }
+  /** adds a record; waits for space, if the ring is full;
+   * aborts if stop occurs */
+  int put (int len, const uchar * msg, pth_event_t stop);
+  /** wakes up the client, if records were added and it is waiting */
+  void signal ();
+  /** tells the client, that no further records follow */
+  void close ();
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "statsserver.h"
+#include "metrics.h"
+
+StatsServer::StatsServer (Trace * tr, const char *path)
+{
+  struct sockaddr_un addr;
+  t = tr;
+  TRACEPRINTF (t, 8, this, "OpenStatsSocket");
+  fd = -1;
+  /* sun_path must keep its terminating NUL */
+  if (strlen (path) >= sizeof (addr.sun_path))
+    {
+      TRACEPRINTF (t, 8, this, "StatsSocket path too long");
+      return;
+    }
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_LOCAL;
+  strcpy (addr.sun_path, path);
+
+  fd = socket (AF_LOCAL, SOCK_STREAM, 0);
+  if (fd == -1)
+    return;
+
+  unlink (path);
+  if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1)
+    {
+      close (fd);
+      fd = -1;
+      return;
+    }
+
+  if (listen (fd, 10) == -1)
+    {
+      close (fd);
+      fd = -1;
+      return;
+    }
+
+  TRACEPRINTF (t, 8, this, "StatsSocket opened");
+  Start ();
+}
+
+StatsServer::~StatsServer ()
+{
+  TRACEPRINTF (t, 8, this, "CloseStatsSocket");
+  Stop ();
+  if (fd != -1)
+    close (fd);
+}
+
+bool
+StatsServer::init ()
+{
+  return fd != -1;
+}
+
+void
+StatsServer::Run (pth_sem_t * stop1)
+{
+  pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
+      int cfd = pth_accept_ev (fd, 0, 0, stop);
+      if (cfd == -1)
+	continue;
+      CArray out;
+      Metric::Dump (out);
+      unsigned start = 0;
+      while (start < out ())
+	{
+	  int i = pth_write_ev (cfd, out.array () + start, out () - start,
+				stop);
+	  if (i <= 0)
+	    break;
+	  start += i;
+	}
+      close (cfd);
+    }
+  pth_event_free (stop, PTH_FREE_THIS);
+}
@@ -28,8 +28,9 @@ Trace::TracePacketUncond (int layer, void *inst, const char *msg, int Len,
 			  const uchar * data)
 {
   int i;
-  int t = time (0);
-  printf ("Layer %d(%08" PRIXPTR ",%08X) %s(%03d):", layer, (uintptr_t) inst, t,
+  timestamp_t t = getTime ();
+  printf ("Layer %d(%08" PRIXPTR ",%08X.%06d) %s(%03d):", layer,
+	  (uintptr_t) inst, (unsigned) (t / 1000000), (int) (t % 1000000),
 	  msg, Len);
   for (i = 0; i < Len; i++)
     printf (" %02X", data[i]);
@@ -40,8 +41,9 @@ void
 Trace::TracePrintf (int layer, void *inst, const char *msg, ...)
 {
   va_list ap;
-  int t = time (0);
-  printf ("Layer %d(%08" PRIXPTR ",%08X) ", layer, (uintptr_t) inst, t);
+  timestamp_t t = getTime ();
+  printf ("Layer %d(%08" PRIXPTR ",%08X.%06d) ", layer, (uintptr_t) inst,
+	  (unsigned) (t / 1000000), (int) (t % 1000000));
   va_start (ap, msg);
   vprintf (msg, ap);
   printf ("\n");
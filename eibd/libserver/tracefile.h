@@ -0,0 +1,58 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+/* Format of the binary trace files written by TraceRing
+ *
+ * All numbers are stored in network byte order. A file starts with
+ * the magic and the version, followed by records. Each record starts
+ * with a header:
+ *  - type (1 byte)
+ *  - trace level (1 byte)
+ *  - message id (2 bytes)
+ *  - payload length (2 bytes)
+ *  - monotonic time stamp in ns (8 bytes)
+ *  - instance pointer (8 bytes)
+ * and is followed by the payload.
+ */
+
+#define TRACEFILE_MAGIC "EIBTRACE"
+#define TRACEFILE_MAGIC_LEN 8
+#define TRACEFILE_VERSION 1
+/** length of magic and version */
+#define TRACEFILE_HEADER_LEN 10
+/** length of the record header */
+#define TRACEREC_HEADER_LEN 22
+
+/** maps the time stamps to the system clock;
+ * payload: system time in ns (8 bytes) at the monotonic time stamp */
+#define TRACEREC_CLOCK 1
+/** defines the text of a message id; payload: text */
+#define TRACEREC_MESSAGE 2
+/** packet trace; payload: packet, message id: message text */
+#define TRACEREC_PACKET 3
+/** text trace; payload: text */
+#define TRACEREC_TEXT 4
+/** records were dropped, as the ring was full;
+ * payload: number of dropped records (4 bytes) */
+#define TRACEREC_LOST 5
+
+#endif
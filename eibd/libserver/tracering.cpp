@@ -0,0 +1,312 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "tracering.h"
+
+TraceRing::TraceRing (const char *file, unsigned ringsize)
+{
+  uchar h[TRACEFILE_HEADER_LEN];
+  int p[2];
+  size = ringsize;
+  start = 0;
+  fill = 0;
+  lost = 0;
+  signaled = false;
+  clockdue = true;
+  memset (msgs, 0, sizeof (msgs));
+  pth_sem_init (&flushsignal);
+  ring = new uchar[size];
+  fd = open (file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+    return;
+  memcpy (h, TRACEFILE_MAGIC, TRACEFILE_MAGIC_LEN);
+  h[8] = (TRACEFILE_VERSION >> 8) & 0xff;
+  h[9] = (TRACEFILE_VERSION) & 0xff;
+  if (write (fd, h, sizeof (h)) != sizeof (h) || pipe (p) == -1)
+    {
+      close (fd);
+      fd = -1;
+      return;
+    }
+  /* a child process writes the file, so that a slow disk only blocks it */
+  writerpid = fork ();
+  if (writerpid == -1)
+    {
+      close (p[0]);
+      close (p[1]);
+      close (fd);
+      fd = -1;
+      return;
+    }
+  if (!writerpid)
+    {
+      close (p[1]);
+      writer (p[0], fd);
+    }
+  close (p[0]);
+  close (fd);
+  fd = p[1];
+  Start ();
+}
+
+TraceRing::~TraceRing ()
+{
+  int status;
+  if (fd != -1)
+    {
+      Stop ();
+      flush ();
+      close (fd);
+      /* wait for the last records, if the writer is our child */
+      pth_waitpid (writerpid, &status, 0);
+    }
+  delete[]ring;
+}
+
+void
+TraceRing::writer (int in, int out)
+{
+  uchar buf[4096];
+  int i, j, l;
+
+  /* eibd writes its last records after these signals */
+  signal (SIGINT, SIG_IGN);
+  signal (SIGTERM, SIG_IGN);
+  signal (SIGHUP, SIG_IGN);
+  while (1)
+    {
+      l = read (in, buf, sizeof (buf));
+      if (l == -1 && errno == EINTR)
+	continue;
+      if (l <= 0)
+	break;
+      for (i = 0; i < l; i += j)
+	{
+	  j = write (out, buf + i, l - i);
+	  if (j == -1 && errno == EINTR)
+	    j = 0;
+	  else if (j <= 0)
+	    break;
+	}
+    }
+  _exit (0);
+}
+
+bool
+TraceRing::init ()
+{
+  return fd != -1;
+}
+
+void
+TraceRing::append (const uchar * data, unsigned len)
+{
+  unsigned pos = (start + fill) % size;
+  unsigned l = size - pos;
+  if (l > len)
+    l = len;
+  memcpy (ring + pos, data, l);
+  memcpy (ring, data + l, len - l);
+  fill += len;
+}
+
+bool
+TraceRing::put (uchar type, int layer, void *inst, unsigned msgid,
+		const uchar * data, unsigned len)
+{
+  uchar h[TRACEREC_HEADER_LEN];
+  uint64_t t = getMonotonicTime ();
+  uint64_t i = (uintptr_t) inst;
+  int j;
+
+  if (len > 0xffff)
+    len = 0xffff;
+  if (fill + TRACEREC_HEADER_LEN + len > size)
+    return false;
+  h[0] = type;
+  h[1] = layer;
+  h[2] = (msgid >> 8) & 0xff;
+  h[3] = (msgid) & 0xff;
+  h[4] = (len >> 8) & 0xff;
+  h[5] = (len) & 0xff;
+  for (j = 0; j < 8; j++)
+    {
+      h[6 + j] = (t >> (56 - 8 * j)) & 0xff;
+      h[14 + j] = (i >> (56 - 8 * j)) & 0xff;
+    }
+  append (h, sizeof (h));
+  append (data, len);
+  if (!signaled && fill > size / 2)
+    {
+      signaled = true;
+      pth_sem_inc (&flushsignal, 0);
+    }
+  return true;
+}
+
+void
+TraceRing::record (uchar type, int layer, void *inst, unsigned msgid,
+		   const uchar * data, unsigned len)
+{
+  if (clockdue)
+    {
+      clockdue = false;
+      putClock ();
+    }
+  if (lost)
+    {
+      uchar l[4];
+      l[0] = (lost >> 24) & 0xff;
+      l[1] = (lost >> 16) & 0xff;
+      l[2] = (lost >> 8) & 0xff;
+      l[3] = (lost) & 0xff;
+      if (!put (TRACEREC_LOST, 0, 0, 0, l, sizeof (l)))
+	{
+	  lost++;
+	  return;
+	}
+      lost = 0;
+    }
+  if (!put (type, layer, inst, msgid, data, len))
+    lost++;
+}
+
+void
+TraceRing::putClock ()
+{
+  uchar c[8];
+  uint64_t t = getTime () * 1000;
+  for (int j = 0; j < 8; j++)
+    c[j] = (t >> (56 - 8 * j)) & 0xff;
+  record (TRACEREC_CLOCK, 0, 0, 0, c, sizeof (c));
+}
+
+unsigned
+TraceRing::msgId (int layer, void *inst, const char *msg)
+{
+  unsigned h = ((uintptr_t) msg >> 2) % TRACERING_MESSAGES;
+  for (unsigned i = 0; i < TRACERING_MESSAGES; i++)
+    {
+      if (msgs[h] == msg)
+	return h + 1;
+      if (!msgs[h])
+	{
+	  if (!put (TRACEREC_MESSAGE, layer, inst, h + 1,
+		    (const uchar *) msg, strlen (msg)))
+	    return 0;
+	  msgs[h] = msg;
+	  return h + 1;
+	}
+      h = (h + 1) % TRACERING_MESSAGES;
+    }
+  return 0;
+}
+
+void
+TraceRing::TracePacketUncond (int layer, void *inst, const char *msg,
+			      int Len, const uchar * data)
+{
+  unsigned id = msgId (layer, inst, msg);
+  if (id)
+    {
+      record (TRACEREC_PACKET, layer, inst, id, data, Len);
+      return;
+    }
+  /* no message id left, store it as text */
+  char buf[1024];
+  int l = snprintf (buf, sizeof (buf), "%s(%03d):", msg, Len);
+  for (int i = 0; i < Len && l + 4 < (int) sizeof (buf); i++)
+    l += sprintf (buf + l, " %02X", data[i]);
+  if (l >= (int) sizeof (buf))
+    l = sizeof (buf) - 1;
+  record (TRACEREC_TEXT, layer, inst, 0, (const uchar *) buf, l);
+}
+
+void
+TraceRing::TracePrintf (int layer, void *inst, const char *msg, ...)
+{
+  char buf[1024];
+  va_list ap;
+  va_start (ap, msg);
+  int l = vsnprintf (buf, sizeof (buf), msg, ap);
+  va_end (ap);
+  if (l < 0)
+    return;
+  if (l >= (int) sizeof (buf))
+    l = sizeof (buf) - 1;
+  record (TRACEREC_TEXT, layer, inst, 0, (const uchar *) buf, l);
+}
+
+void
+TraceRing::flush ()
+{
+  while (fill)
+    {
+      unsigned l = size - start;
+      if (l > fill)
+	l = fill;
+      /* only waits this thread, if the writer falls behind */
+      int i = pth_write (fd, ring + start, l);
+      if (i == -1 && errno == EINTR)
+	continue;
+      if (i <= 0)
+	{
+	  /* the records can not be written, drop them */
+	  start = (start + fill) % size;
+	  fill = 0;
+	  break;
+	}
+      start = (start + i) % size;
+      fill -= i;
+    }
+  signaled = false;
+  /* resynchronize the clocks with the next record */
+  clockdue = true;
+}
+
+void
+TraceRing::Run (pth_sem_t * stop1)
+{
+  pth_event_t stop = pth_event (PTH_EVENT_SEM, stop1);
+  pth_event_t sig = pth_event (PTH_EVENT_SEM, &flushsignal);
+  pth_event_t timeout = pth_event (PTH_EVENT_RTIME, pth_time (1, 0));
+  while (pth_event_status (stop) != PTH_STATUS_OCCURRED)
+    {
+      pth_event_concat (sig, stop, timeout, NULL);
+      pth_wait (sig);
+      pth_event_isolate (sig);
+      pth_event_isolate (timeout);
+      if (pth_event_status (sig) == PTH_STATUS_OCCURRED)
+	pth_sem_dec (&flushsignal);
+      pth_event (PTH_EVENT_RTIME | PTH_MODE_REUSE, timeout, pth_time (1, 0));
+      flush ();
+    }
+  pth_event_free (timeout, PTH_FREE_THIS);
+  pth_event_free (sig, PTH_FREE_THIS);
+  pth_event_free (stop, PTH_FREE_THIS);
+}
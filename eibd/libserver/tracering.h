@@ -0,0 +1,97 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TRACERING_H
+#define TRACERING_H
+
+#include "trace.h"
+#include "threads.h"
+#include "tracefile.h"
+
+/** number of message texts, which get a message id */
+#define TRACERING_MESSAGES 1024
+
+/** trace, which appends binary records to an in memory ring instead
+ * of printing them
+ *
+ * A background thread passes the ring through a pipe to a child
+ * process, which writes it to a file. eibtrace turns the file
+ * into the text format of Trace. If the ring is full, records are
+ * dropped and counted. Message texts of packet traces must be string
+ * constants, as they are identified by their address.
+ */
+class TraceRing:public Trace, private Thread
+{
+  /** pipe to the writer process */
+  int fd;
+  /** writer process */
+  pid_t writerpid;
+  /** ring buffer */
+  uchar *ring;
+  /** ring size */
+  unsigned size;
+  /** position of the oldest byte */
+  unsigned start;
+  /** number of used bytes */
+  unsigned fill;
+  /** number of records dropped since the last TRACEREC_LOST record */
+  unsigned long lost;
+  /** message texts, indexed by message id - 1 */
+  const char *msgs[TRACERING_MESSAGES];
+  /** signals the writer, that the ring is half full */
+  pth_sem_t flushsignal;
+  /** flushsignal was raised since the last flush */
+  bool signaled;
+  /** a TRACEREC_CLOCK record is due before the next record */
+  bool clockdue;
+
+  void Run (pth_sem_t * stop);
+  /** copies the records from in to the file out until in is closed;
+   * runs in the writer process and never returns */
+  static void writer (int in, int out);
+  /** copies len bytes to the ring end */
+  void append (const uchar * data, unsigned len);
+  /** appends a record, returns false if it does not fit */
+  bool put (uchar type, int layer, void *inst, unsigned msgid,
+	    const uchar * data, unsigned len);
+  /** appends a record after reporting lost records; counts it as lost,
+   * if it does not fit */
+  void record (uchar type, int layer, void *inst, unsigned msgid,
+	       const uchar * data, unsigned len);
+  /** appends a TRACEREC_CLOCK record; only called by record */
+  void putClock ();
+  /** returns the message id of msg or 0, if there is no id left */
+  unsigned msgId (int layer, void *inst, const char *msg);
+  /** passes the ring content to the writer */
+  void flush ();
+public:
+  /** opens the trace file
+   * @param file path of the trace file
+   * @param ringsize size of the ring in bytes
+   */
+    TraceRing (const char *file, unsigned ringsize);
+    virtual ~ TraceRing ();
+  bool init ();
+
+  void TracePacketUncond (int layer, void *inst, const char *msg,
+			  int Len, const uchar * data);
+  void TracePrintf (int layer, void *inst, const char *msg, ...);
+};
+
+#endif
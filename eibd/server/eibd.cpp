@@ -27,6 +27,8 @@
 #include <sys/stat.h>
 #include "layer3.h"
 #include "localserver.h"
+#include "tracering.h"
+#include "statsserver.h"
 #include "inetserver.h"
 #include "eibnetserver.h"
 #include "groupcacheclient.h"
@@ -36,6 +38,18 @@
 #define OPT_BACK_TPUARTS_ACKINDIVIDUAL 3
 #define OPT_BACK_TPUARTS_DISCH_RESET 4
 #define OPT_BACK_EMI_NOQUEUE 5
+#define OPT_QUEUE_SIZE 6
+#define OPT_QUEUE_OVERFLOW 7
+#define OPT_TRACE_FILE 8
+#define OPT_TRACE_RING 9
+#define OPT_STATS_SOCKET 10
+#define OPT_CACHE_FILE 11
+#define OPT_CACHE_INTERVAL 12
+#define OPT_CACHE_LOG 13
+#define OPT_CACHE_READ_RATE 14
+#define OPT_CACHE_HISTORY 15
+#define OPT_CACHE_PROXY 16
+#define OPT_LINE_FILTER 17
 
 /** structure to store the arguments */
 struct arguments
@@ -61,6 +75,29 @@ struct arguments
   bool groupcache;
   int backendflags;
   const char *serverip;
+  /** receive queue limit of each client */
+  unsigned queuesize;
+  Overflow_Policy queuepolicy;
+  /** path to the binary trace file */
+  const char *tracefile;
+  /** size of the trace ring in bytes */
+  unsigned tracering;
+  /** path of the unix domain socket for the metrics report */
+  const char *statssocket;
+  /** path of the group cache snapshot */
+  const char *cachefile;
+  /** seconds between two group cache snapshots */
+  unsigned cacheinterval;
+  /** number of entries of the group cache change log */
+  unsigned cachelog;
+  /** GroupValue_Read sent by the group cache per second */
+  unsigned cachereadrate;
+  /** group address ranges with value history */
+  const char *cachehistory;
+  /** maximum age of cached values answered to clients */
+  unsigned cacheproxy;
+  /** destination address ranges routed to each line */
+  const char *linefilter;
 };
 /** storage for the arguments*/
 struct arguments arg;
@@ -103,7 +140,20 @@ struct urldef URLs[] = {
   {0, 0, 0}
 };
 
-void (*Cleanup) ();
+/** cleanup functions of the used backends */
+Array < void (*)() > Cleanup;
+
+/** remembers a cleanup function, each is only called once */
+void
+addCleanup (void (*c) ())
+{
+  if (!c)
+    return;
+  for (unsigned i = 0; i < Cleanup (); i++)
+    if (Cleanup[i] == c)
+      return;
+  Cleanup.add (c);
+}
 
 /** determines the right backend for the url and creates it */
 Layer2Interface *
@@ -119,7 +169,7 @@ Create (const char *url, int flags, Trace * t)
     {
       if (strlen (u->prefix) == p && !memcmp (u->prefix, url, p))
 	{
-	  Cleanup = u->Cleanup;
+	  addCleanup (u->Cleanup);
 	  return u->Create (url + p + 1, flags, t);
 	}
       u++;
@@ -137,12 +187,71 @@ readaddr (const char *addr)
   return ((a & 0x0f) << 12) | ((b & 0x0f) << 8) | ((c & 0xff));
 }
 
+/** parses an EIB group address or individual address at s
+ * @param group set to true for a group address
+ * @param n set to the number of characters parsed, 0 on failure
+ */
+static eibaddr_t
+readfilteraddr (const char *s, bool & group, int &n)
+{
+  unsigned a, b, c;
+  n = 0;
+  if (sscanf (s, "%u/%u/%u%n", &a, &b, &c, &n) == 3 && n)
+    {
+      group = 1;
+      return ((a & 0x1f) << 11) | ((b & 0x07) << 8) | (c & 0xff);
+    }
+  n = 0;
+  if (sscanf (s, "%u.%u.%u%n", &a, &b, &c, &n) == 3 && n)
+    {
+      group = 0;
+      return ((a & 0x0f) << 12) | ((b & 0x0f) << 8) | (c & 0xff);
+    }
+  n = 0;
+  return 0;
+}
+
+/** applies the route filters LINE:FROM[-TO],... to Layer 3 */
+static bool
+setLineFilter (Layer3 * l3, const char *spec)
+{
+  while (spec && *spec)
+    {
+      unsigned line;
+      bool group, group2;
+      int n = 0;
+      eibaddr_t start, end;
+      if (sscanf (spec, "%u:%n", &line, &n) != 1 || !n)
+	return 0;
+      spec += n;
+      start = end = readfilteraddr (spec, group, n);
+      if (!n)
+	return 0;
+      spec += n;
+      if (*spec == '-')
+	{
+	  end = readfilteraddr (spec + 1, group2, n);
+	  if (!n || group != group2)
+	    return 0;
+	  spec += n + 1;
+	}
+      if (!l3->addRouteFilter (line, start, end, group))
+	return 0;
+      if (*spec == ',')
+	spec++;
+      else if (*spec)
+	return 0;
+    }
+  return 1;
+}
+
 /** version */
 const char *argp_program_version = "eibd " VERSION;
 /** documentation */
 static char doc[] =
   "eibd -- a commonication stack for EIB/KNX\n"
   "(C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>\n"
+  "if more than one URL is given, frames are routed between the lines\n"
   "supported URLs are:\n"
 #undef L2_NAME
 #define L2_NAME(a) a##_URL
@@ -154,7 +263,7 @@ static char doc[] =
   "\n";
 
 /** documentation for arguments*/
-static char args_doc[] = "URL";
+static char args_doc[] = "URL [URL...]";
 
 /** option list */
 static struct argp_option options[] = {
@@ -181,6 +290,18 @@ static struct argp_option options[] = {
 #ifdef HAVE_GROUPCACHE
   {"GroupCache", 'c', 0, 0,
    "enable caching of group communication network state"},
+  {"cache-file", OPT_CACHE_FILE, "FILE", 0,
+   "restore the group cache from FILE at startup and save it there periodically and on exit"},
+  {"cache-save-interval", OPT_CACHE_INTERVAL, "SECONDS", 0,
+   "seconds between two saves of the group cache (default 300)"},
+  {"cache-log-size", OPT_CACHE_LOG, "COUNT", 0,
+   "number of group cache changes kept for clients reading them, rounded up to a power of 2 (default 4096)"},
+  {"cache-read-rate", OPT_CACHE_READ_RATE, "COUNT", 0,
+   "maximum number of reads sent per second for values missing in the group cache, 0 for no limit (default 20)"},
+  {"cache-history", OPT_CACHE_HISTORY, "DEPTH[:FROM[-TO]],...", 0,
+   "keep the last DEPTH values of the group addresses FROM to TO (all, if omitted)"},
+  {"cache-proxy", OPT_CACHE_PROXY, "SECONDS", 0,
+   "answer group reads of clients from the group cache, if the value is not older than SECONDS"},
 #endif
 #ifdef HAVE_EIBNETIPTUNNEL
   {"no-tunnel-client-queuing", OPT_BACK_TUNNEL_NOQUEUE, 0, 0,
@@ -196,6 +317,18 @@ static struct argp_option options[] = {
 #endif
   {"no-emi-send-queuing", OPT_BACK_EMI_NOQUEUE, 0, 0,
    "wait for L_Data_ind while sending (for all EMI based backends)"},
+  {"client-queue-size", OPT_QUEUE_SIZE, "COUNT", 0,
+   "limit the receive queue of each client to COUNT packets (default unlimited)"},
+  {"client-queue-overflow", OPT_QUEUE_OVERFLOW, "POLICY", 0,
+   "if a client queue is full: drop-oldest (default), drop-newest or disconnect"},
+  {"trace-file", OPT_TRACE_FILE, "FILE", 0,
+   "write traces in binary form to FILE (decode with eibtrace)"},
+  {"trace-ring-size", OPT_TRACE_RING, "BYTES", 0,
+   "size of the in memory buffer of the binary trace (default 1 MB)"},
+  {"stats-socket", OPT_STATS_SOCKET, "PATH", 0,
+   "write a text report of the runtime metrics to each client connecting to the unix domain socket PATH"},
+  {"line-filter", OPT_LINE_FILTER, "LINE:FROM[-TO],...", 0,
+   "route only frames to the destinations FROM to TO (x/y/z or x.y.z) to the line with the index LINE (0 for the first URL); lines without a range of an address type get all frames of this type"},
   {0}
 };
 
@@ -257,6 +390,51 @@ parse_opt (int key, char *arg, struct argp_state *state)
     case OPT_BACK_EMI_NOQUEUE:
       arguments->backendflags |= FLAG_B_EMI_NOQUEUE;
       break;
+    case OPT_QUEUE_SIZE:
+      arguments->queuesize = atoi (arg);
+      break;
+    case OPT_QUEUE_OVERFLOW:
+      if (!strcmp (arg, "drop-oldest"))
+	arguments->queuepolicy = Overflow_DropOldest;
+      else if (!strcmp (arg, "drop-newest"))
+	arguments->queuepolicy = Overflow_DropNewest;
+      else if (!strcmp (arg, "disconnect"))
+	arguments->queuepolicy = Overflow_Disconnect;
+      else
+	argp_error (state, "unknown overflow policy %s", arg);
+      break;
+    case OPT_TRACE_FILE:
+      arguments->tracefile = arg;
+      break;
+    case OPT_TRACE_RING:
+      arguments->tracering = atoi (arg);
+      break;
+    case OPT_STATS_SOCKET:
+      arguments->statssocket = arg;
+      break;
+    case OPT_CACHE_FILE:
+      arguments->cachefile = arg;
+      break;
+    case OPT_CACHE_INTERVAL:
+      if (atoi (arg) < 1)
+	argp_error (state, "invalid cache save interval %s", arg);
+      arguments->cacheinterval = atoi (arg);
+      break;
+    case OPT_CACHE_LOG:
+      arguments->cachelog = atoi (arg);
+      break;
+    case OPT_CACHE_READ_RATE:
+      arguments->cachereadrate = atoi (arg);
+      break;
+    case OPT_CACHE_HISTORY:
+      arguments->cachehistory = arg;
+      break;
+    case OPT_CACHE_PROXY:
+      arguments->cacheproxy = atoi (arg);
+      break;
+    case OPT_LINE_FILTER:
+      arguments->linefilter = arg;
+      break;
     default:
       return ARGP_ERR_UNKNOWN;
     }
@@ -308,6 +486,7 @@ main (int ac, char *ag[])
   Server *s;
   Layer2Interface *l2;
   Layer3 *l3;
+  StatsServer *stats = 0;
 #ifdef HAVE_EIBNETIPSERVER
   EIBnetServer *serv = 0;
 #endif
@@ -315,12 +494,13 @@ main (int ac, char *ag[])
   memset (&arg, 0, sizeof (arg));
   arg.addr = 0x0001;
   arg.errorlevel = LEVEL_WARNING;
+  arg.tracering = 1024 * 1024;
+  arg.cacheinterval = 300;
+  arg.cachereadrate = 20;
 
   argp_parse (&argp, ac, ag, 0, &index, &arg);
   if (index > ac - 1)
     die ("url expected");
-  if (index < ac - 1)
-    die ("unexpected parameter");
 
   if (arg.port == 0 && arg.name == 0 && arg.serverip == 0)
     die ("No listen-address given");
@@ -328,12 +508,23 @@ main (int ac, char *ag[])
   signal (SIGPIPE, SIG_IGN);
   pth_init ();
 
-  Trace t;
-  t.SetTraceLevel (arg.tracelevel);
-  t.SetErrorLevel (arg.errorlevel);
+  Trace *t;
+  if (arg.tracefile)
+    {
+      if (arg.tracering < 4096)
+	die ("trace ring size too small");
+      TraceRing *r = new TraceRing (arg.tracefile, arg.tracering);
+      if (!r->init ())
+	die ("Can not open trace file %s", arg.tracefile);
+      t = r;
+    }
+  else
+    t = new Trace;
+  t->SetTraceLevel (arg.tracelevel);
+  t->SetErrorLevel (arg.errorlevel);
 
   if (getuid () == 0)
-    ERRORPRINTF (&t, 0x37000001, 0, "EIBD should not run as root");
+    ERRORPRINTF (t, 0x37000001, 0, "EIBD should not run as root");
 
   if (arg.daemon)
     {
@@ -363,29 +554,49 @@ main (int ac, char *ag[])
 	fclose (pidf);
       }
 
-  l2 = Create (ag[index], arg.backendflags, &t);
+  l2 = Create (ag[index], arg.backendflags, t);
   if (!l2 || !l2->init ())
     die ("initialisation of the backend failed");
-  l3 = new Layer3 (l2, &t);
+  l3 = new Layer3 (l2, t);
+  l3->queuelimit.capacity = arg.queuesize;
+  l3->queuelimit.policy = arg.queuepolicy;
+  for (index++; index < ac; index++)
+    {
+      l2 = Create (ag[index], arg.backendflags, t);
+      if (!l2 || !l2->init ())
+	die ("initialisation of the backend %s failed", ag[index]);
+      if (!l3->addLayer2 (l2))
+	die ("adding the backend %s failed", ag[index]);
+    }
+  if (!setLineFilter (l3, arg.linefilter))
+    die ("invalid line filter %s", arg.linefilter);
   if (arg.port)
     {
-      s = new InetServer (l3, &t, arg.port);
+      s = new InetServer (l3, t, arg.port);
       if (!s->init ())
 	die ("initialisation of the eibd inet protocol failed");
       server.put (s);
     }
   if (arg.name)
     {
-      s = new LocalServer (l3, &t, arg.name);
+      s = new LocalServer (l3, t, arg.name);
       if (!s->init ())
 	die ("initialisation of the eibd unix protocol failed");
       server.put (s);
     }
+  if (arg.statssocket)
+    {
+      stats = new StatsServer (t, arg.statssocket);
+      if (!stats->init ())
+	die ("initialisation of the metrics socket failed");
+    }
 #ifdef HAVE_EIBNETIPSERVER
-  serv = startServer (l3, &t);
+  serv = startServer (l3, t);
 #endif
 #ifdef HAVE_GROUPCACHE
-  if (!CreateGroupCache (l3, &t, arg.groupcache))
+  if (!CreateGroupCache (l3, t, arg.groupcache, arg.cachefile,
+			 arg.cacheinterval, arg.cachelog, arg.cachereadrate,
+			 arg.cachehistory, arg.cacheproxy))
     die ("initialisation of the group cache failed");
 #endif
 
@@ -409,7 +620,7 @@ main (int ac, char *ag[])
 	    open (arg.daemon, O_WRONLY | O_APPEND | O_CREAT, FILE_MODE);
 	  if (fd == -1)
 	    {
-	      ERRORPRINTF (&t, 0x27000002, 0, "can't open log file %s",
+	      ERRORPRINTF (t, 0x27000002, 0, "can't open log file %s",
 			   arg.daemon);
 	      continue;
 	    }
@@ -428,6 +639,8 @@ main (int ac, char *ag[])
 
   while (!server.isempty ())
     delete server.get ();
+  if (stats)
+    delete stats;
 #ifdef HAVE_EIBNETIPSERVER
   if (serv)
     delete serv;
@@ -437,8 +650,9 @@ main (int ac, char *ag[])
 #endif
 
   delete l3;
-  if (Cleanup)
-    Cleanup ();
+  for (unsigned i = 0; i < Cleanup (); i++)
+    Cleanup[i] ();
+  delete t;
 
   if (arg.pidfile)
     unlink (arg.pidfile);
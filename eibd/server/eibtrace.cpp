@@ -0,0 +1,134 @@
+/*
+    EIBD eib bus access and management daemon
+    Copyright (C) 2005-2011 Martin Koegler <mkoegler@auto.tuwien.ac.at>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tracefile.h"
+
+/** prints a message and exits */
+static void
+die (const char *msg, ...)
+{
+  va_list ap;
+  va_start (ap, msg);
+  vfprintf (stderr, msg, ap);
+  fprintf (stderr, "\n");
+  va_end (ap);
+  exit (1);
+}
+
+/** reads a big endian number of len bytes */
+static uint64_t
+get (const unsigned char *p, int len)
+{
+  uint64_t v = 0;
+  for (int i = 0; i < len; i++)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+int
+main (int ac, char *ag[])
+{
+  FILE *f;
+  unsigned char h[TRACEREC_HEADER_LEN];
+  unsigned char *data;
+  /* message texts by id, too large for the stack */
+  static char *msgs[0x10000];
+  /* monotonic and system time of the last clock record in ns */
+  uint64_t mono = 0, real = 0;
+
+  if (ac != 2)
+    die ("usage: %s tracefile", ag[0]);
+  if (!strcmp (ag[1], "-"))
+    f = stdin;
+  else
+    f = fopen (ag[1], "rb");
+  if (!f)
+    die ("Can not open file %s", ag[1]);
+
+  if (fread (h, 1, TRACEFILE_HEADER_LEN, f) != TRACEFILE_HEADER_LEN
+      || memcmp (h, TRACEFILE_MAGIC, TRACEFILE_MAGIC_LEN))
+    die ("%s is no trace file", ag[1]);
+  if (get (h + TRACEFILE_MAGIC_LEN, 2) != TRACEFILE_VERSION)
+    die ("unsupported trace file version %d",
+	 (int) get (h + TRACEFILE_MAGIC_LEN, 2));
+
+  memset (msgs, 0, sizeof (msgs));
+  data = (unsigned char *) malloc (0x10000 + 1);
+  if (!data)
+    die ("out of memory");
+
+  while (fread (h, 1, TRACEREC_HEADER_LEN, f) == TRACEREC_HEADER_LEN)
+    {
+      int type = h[0];
+      int layer = h[1];
+      unsigned msgid = get (h + 2, 2);
+      unsigned len = get (h + 4, 2);
+      uint64_t ts = get (h + 6, 8);
+      uint64_t inst = get (h + 14, 8);
+      uint64_t t;
+
+      if (fread (data, 1, len, f) != len)
+	die ("truncated record");
+      data[len] = 0;
+      t = (real + (ts - mono)) / 1000;
+
+      switch (type)
+	{
+	case TRACEREC_CLOCK:
+	  if (len >= 8)
+	    {
+	      mono = ts;
+	      real = get (data, 8);
+	    }
+	  break;
+	case TRACEREC_MESSAGE:
+	  free (msgs[msgid]);
+	  msgs[msgid] = strdup ((char *) data);
+	  break;
+	case TRACEREC_PACKET:
+	  printf ("Layer %d(%08" PRIX64 ",%08X.%06d) %s(%03d):", layer, inst,
+		  (unsigned) (t / 1000000), (int) (t % 1000000),
+		  msgs[msgid] ? msgs[msgid] : "?", len);
+	  for (unsigned i = 0; i < len; i++)
+	    printf (" %02X", data[i]);
+	  printf ("\n");
+	  break;
+	case TRACEREC_TEXT:
+	  printf ("Layer %d(%08" PRIX64 ",%08X.%06d) %s\n", layer, inst,
+		  (unsigned) (t / 1000000), (int) (t % 1000000), data);
+	  break;
+	case TRACEREC_LOST:
+	  if (len >= 4)
+	    printf ("%u trace records lost\n", (unsigned) get (data, 4));
+	  break;
+	default:
+	  /* unknown records are skipped */
+	  break;
+	}
+    }
+
+  if (f != stdin)
+    fclose (f);
+  return 0;
+}